@@ -9,6 +9,10 @@
 // Global variable to store the API key
 static char api_key[256] = "";
 
+// generateContent endpoint; empty means GEMINI_API_URL or the live service
+#define DEFAULT_API_URL "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent"
+static char api_url[512] = "";
+
 // Structure to store the response data
 struct ResponseData {
     char *data;
@@ -55,6 +59,21 @@ const char *getApiKey() {
     return api_key;
 }
 
+// Set the endpoint the requests go to, e.g. a local stand-in server
+void setApiUrl(const char *url) {
+    strncpy(api_url, url, sizeof(api_url) - 1);
+    api_url[sizeof(api_url) - 1] = '\0';
+}
+
+// Get the endpoint: the one set, else GEMINI_API_URL, else the live service
+const char *getApiUrl() {
+    if (api_url[0]) {
+        return api_url;
+    }
+    const char *env = getenv("GEMINI_API_URL");
+    return env && env[0] ? env : DEFAULT_API_URL;
+}
+
 // Callback function for handling the API response
 static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
@@ -139,9 +158,8 @@ int rateMoveWithAI(const char *move, const char *moveHistory) {
     sprintf(payload, "{\"contents\":[{\"parts\":[{\"text\":\"%s\"}]}]}", prompt);
 
     // Create the URL with the API key
-    char url[512];
-    sprintf(url, "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent?key=%s",
-            api_key);
+    char url[1024];
+    snprintf(url, sizeof(url), "%s?key=%s", getApiUrl(), api_key);
 
     // Initialize libcurl
     curl_global_init(CURL_GLOBAL_ALL);
@@ -196,7 +214,7 @@ void displayMoveRating(int fromRow, int fromCol, int toRow, int toCol) {
     printf("Getting AI rating for move %s...\n", moveStr);
 
     // Call AI to rate the move
-    int rating = rateMoveWithAI(moveStr, moveHistory);
+    int rating = rateMoveWithAI(moveStr, getMoveHistory());
 
     // Display the rating with a descriptive message
     if (rating == -1) {
@@ -273,9 +291,8 @@ int getBlackMove(const char *moveHistory, int *fromRow, int *fromCol, int *toRow
     sprintf(payload, "{\"contents\":[{\"parts\":[{\"text\":\"%s\"}]}]}", prompt);
 
     // Create the URL with the API key
-    char url[512];
-    sprintf(url, "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent?key=%s",
-            api_key);
+    char url[1024];
+    snprintf(url, sizeof(url), "%s?key=%s", getApiUrl(), api_key);
 
     // Initialize libcurl
     curl_global_init(CURL_GLOBAL_ALL);
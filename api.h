@@ -8,6 +8,11 @@ const char *getApiKey();
 
 void setApiKey(const char* key);
 
+// Set the generateContent endpoint (default: GEMINI_API_URL, then the live service)
+void setApiUrl(const char* url);
+// Get the endpoint requests are sent to
+const char *getApiUrl();
+
 void setAiPersonality(const char* personality);
 // Set the AI personality for the API
 
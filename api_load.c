@@ -0,0 +1,202 @@
+// Load driver for the Gemini API path: a number of concurrent streams send
+// requests through api.c (getBlackMove, or rateMoveWithAI with --rate) and
+// retry the ones that fail. Reports latency percentiles per request, retries
+// included, along with throughput and how often requests had to be retried.
+//
+// Usage: c_chess_api_load [-c streams] [-n requests] [-r retries] [-b backoff_ms]
+//                         [-u url] [--rate]
+//
+// -n is per stream. Without -u or GEMINI_API_URL it targets the local
+// stand-in server (c_chess_mock_gemini) rather than the live service.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include "api.h"
+
+#define DEFAULT_STREAMS 8
+#define DEFAULT_REQUESTS 50
+#define DEFAULT_RETRIES 2
+#define LOCAL_URL "http://127.0.0.1:8089/v1beta/models/gemini-2.0-flash:generateContent"
+
+static const char *moveHistory = "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O";
+
+typedef struct {
+    int requests;
+    int retries;
+    int backoffMs;
+    int rateMoves;
+} LoadConfig;
+
+typedef struct {
+    const LoadConfig *config;
+    double *latencies;                  // milliseconds per request
+    unsigned long long attempts;
+    unsigned long long retried;         // requests that needed more than one attempt
+    unsigned long long failed;          // requests that ran out of retries
+} Stream;
+
+static double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void sleepMs(int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+// The stand-in never rates a move 0, so 0 (what rateMoveWithAI returns when
+// the transfer fails) counts as a failure along with no rating at all
+static int attemptRequest(const LoadConfig *config) {
+    if (config->rateMoves) {
+        int rating = rateMoveWithAI("b5a4", moveHistory);
+        return rating > 0;
+    }
+    int fromRow, fromCol, toRow, toCol;
+    if (!getBlackMove(moveHistory, &fromRow, &fromCol, &toRow, &toCol)) {
+        return 0;
+    }
+    return fromRow >= 0 && fromRow < 8 && fromCol >= 0 && fromCol < 8 &&
+           toRow >= 0 && toRow < 8 && toCol >= 0 && toCol < 8;
+}
+
+static void *runStream(void *arg) {
+    Stream *stream = arg;
+    const LoadConfig *config = stream->config;
+
+    for (int i = 0; i < config->requests; ++i) {
+        double start = now();
+        int attempt = 0;
+        int ok;
+        for (;;) {
+            stream->attempts++;
+            ok = attemptRequest(config);
+            if (ok || attempt == config->retries) {
+                break;
+            }
+            // Exponential backoff between attempts
+            if (config->backoffMs > 0) {
+                sleepMs(config->backoffMs << attempt);
+            }
+            attempt++;
+        }
+        stream->latencies[i] = (now() - start) * 1000.0;
+        if (attempt > 0) stream->retried++;
+        if (!ok) stream->failed++;
+    }
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const double *sorted, int count, double fraction) {
+    int rank = (int)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-c streams] [-n requests] [-r retries] [-b backoff_ms] [-u url] [--rate]\n",
+            program);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    LoadConfig config = {DEFAULT_REQUESTS, DEFAULT_RETRIES, 0, 0};
+    int streamCount = DEFAULT_STREAMS;
+    const char *url = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rate") == 0) {
+            config.rateMoves = 1;
+        } else if (i + 1 >= argc) {
+            return usage(argv[0]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            streamCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            config.requests = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            config.retries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            config.backoffMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0) {
+            url = argv[++i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (streamCount <= 0 || config.requests <= 0 || config.retries < 0 || config.backoffMs < 0) {
+        return usage(argv[0]);
+    }
+
+    if (url) {
+        setApiUrl(url);
+    } else if (!getenv("GEMINI_API_URL")) {
+        setApiUrl(LOCAL_URL);
+    }
+    setApiKey(getenv("GEMINI_API_KEY") ? getenv("GEMINI_API_KEY") : "load-test");
+    // Held for the whole run, so the per-request init and cleanup in api.c
+    // only adjust libcurl's reference count and never tear it down mid-transfer
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    Stream *streams = calloc((size_t)streamCount, sizeof(Stream));
+    pthread_t *threads = malloc((size_t)streamCount * sizeof(pthread_t));
+    double *latencies = malloc((size_t)streamCount * (size_t)config.requests * sizeof(double));
+    if (!streams || !threads || !latencies) {
+        fprintf(stderr, "Error: Could not allocate %d streams\n", streamCount);
+        return 1;
+    }
+
+    printf("%d streams x %d %s requests to %s\n", streamCount, config.requests,
+           config.rateMoves ? "rating" : "move", getApiUrl());
+    fflush(stdout);
+
+    double start = now();
+    int started = 0;
+    for (; started < streamCount; ++started) {
+        streams[started].config = &config;
+        streams[started].latencies = latencies + (size_t)started * (size_t)config.requests;
+        if (pthread_create(&threads[started], NULL, runStream, &streams[started]) != 0) {
+            fprintf(stderr, "Error: Could not start stream %d\n", started);
+            break;
+        }
+    }
+    unsigned long long attempts = 0, retried = 0, failed = 0;
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+        attempts += streams[i].attempts;
+        retried += streams[i].retried;
+        failed += streams[i].failed;
+    }
+    double seconds = now() - start;
+    curl_global_cleanup();
+
+    int total = started * config.requests;
+    if (total == 0) {
+        return 1;
+    }
+    qsort(latencies, (size_t)total, sizeof(double), compareDoubles);
+    printf("Requests:   %d in %.2f s, %.1f requests/sec\n", total, seconds, total / seconds);
+    printf("Latency:    p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", percentile(latencies, total, 0.5),
+           percentile(latencies, total, 0.99), latencies[total - 1]);
+    printf("Attempts:   %llu, %.3f per request\n", attempts, (double)attempts / total);
+    printf("Retried:    %llu requests (%.1f%%)\n", retried, 100.0 * (double)retried / total);
+    printf("Failed:     %llu requests (%.1f%%) after %d retries\n", failed, 100.0 * (double)failed / total,
+           config.retries);
+
+    free(streams);
+    free(threads);
+    free(latencies);
+    return 0;
+}
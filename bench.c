@@ -0,0 +1,431 @@
+// Microbenchmarks for the board hot paths: each function is timed over a
+// fixed corpus of middlegame and endgame positions.
+//
+// Usage: c_chess_bench [--reps N] [--json <file>] [--baseline <file> [--tolerance percent]]
+//        c_chess_bench search [depth] [hash MB]
+//
+// Every sample times PASSES_PER_SAMPLE passes over the corpus and divides by
+// the calls made, so a sample is a mean time per call; warm-up passes are
+// thrown away. The median and the 99th percentile are taken over those sample
+// means, with cycles per call from the time-stamp counter where the CPU has
+// one. The JSON output keeps a fixed order and format so runs from two commits
+// can be diffed, and --baseline fails the run if any median is more than the
+// tolerance (default 10%) slower than in an earlier JSON file.
+//
+// "search" instead searches a fixed set of positions and prints the node
+// total, the search signature that ctest checks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chess.h"
+#include "movegen.h"
+#include "transposition.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAVE_TSC 1
+static unsigned long long readCycles() { return __rdtsc(); }
+#else
+#define HAVE_TSC 0
+static unsigned long long readCycles() { return 0; }
+#endif
+
+#define WARMUP_PASSES 3
+#define DEFAULT_REPS 51
+#define PASSES_PER_SAMPLE 20
+#define DEFAULT_TOLERANCE 10.0
+
+static const char *corpusFens[] = {
+    // Middlegames
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2Q1RK1 b - - 0 9",
+    "2rq1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1P2PN2/PB1NBPPP/2RQ1RK1 w - - 0 11",
+    "r1b2rk1/2q1bppp/p2p1n2/np2p3/3PP3/5N1P/PPBN1PP1/R1BQR1K1 b - - 0 13",
+    "r3r1k1/pp3pbp/1qp1b1p1/2B5/2BP4/Q1n2N2/P4PPP/3R1K1R w - - 0 18",
+    // Endgames
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+    "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1",
+    "8/5pk1/6p1/7p/7P/6P1/5PK1/8 w - - 0 40",
+    "8/8/4kp2/8/5PK1/8/8/8 w - - 0 50",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 30",
+    "8/3k4/8/8/8/8/3Q4/3K4 w - - 0 60",
+    "2r3k1/5pp1/7p/8/8/7P/5PP1/2R3K1 b - - 0 35",
+};
+
+#define CORPUS_SIZE ((int)(sizeof(corpusFens) / sizeof(corpusFens[0])))
+
+static Position corpus[CORPUS_SIZE];
+static MoveList corpusMoves[CORPUS_SIZE];   // legal moves of each position
+static volatile unsigned long long sink;   // keeps results observable
+
+// One pass over the corpus per function; returns the number of calls made
+static int passIsValidMove() {
+    int calls = 0;
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        for (int i = 0; i < corpusMoves[p].count; ++i) {
+            Move m = corpusMoves[p].moves[i];
+            sink += isValidMove(&corpus[p], SQUARE_ROW(MOVE_FROM(m)), SQUARE_COL(MOVE_FROM(m)),
+                                SQUARE_ROW(MOVE_TO(m)), SQUARE_COL(MOVE_TO(m)));
+            calls++;
+        }
+    }
+    return calls;
+}
+
+static int passIsKingInCheck() {
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        sink += isKingInCheck(&corpus[p], corpus[p].sideToMove);
+    }
+    return CORPUS_SIZE;
+}
+
+static int passMoveWouldExposeCheck() {
+    int calls = 0;
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        for (int i = 0; i < corpusMoves[p].count; ++i) {
+            Move m = corpusMoves[p].moves[i];
+            sink += moveWouldExposeCheck(&corpus[p], SQUARE_ROW(MOVE_FROM(m)), SQUARE_COL(MOVE_FROM(m)),
+                                         SQUARE_ROW(MOVE_TO(m)), SQUARE_COL(MOVE_TO(m)),
+                                         corpus[p].sideToMove);
+            calls++;
+        }
+    }
+    return calls;
+}
+
+static int passHasLegalMoves() {
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        sink += hasLegalMoves(&corpus[p], corpus[p].sideToMove);
+    }
+    return CORPUS_SIZE;
+}
+
+static int passGenerateLegalMoves() {
+    MoveList list;
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        generateLegalMoves(&corpus[p], corpus[p].sideToMove, &list);
+        sink += list.count;
+    }
+    return CORPUS_SIZE;
+}
+
+// Status lookups hit the game-status cache after the first pass, as they do
+// when the search returns to a position
+static int passEvaluateBoard() {
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        sink += (unsigned long long)evaluateBoard(&corpus[p]);
+    }
+    return CORPUS_SIZE;
+}
+
+static int passComputeZobristKey() {
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        sink += computeZobristKey(&corpus[p]);
+    }
+    return CORPUS_SIZE;
+}
+
+typedef struct {
+    const char *name;
+    int (*pass)();
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    {"isValidMove", passIsValidMove},
+    {"isKingInCheck", passIsKingInCheck},
+    {"moveWouldExposeCheck", passMoveWouldExposeCheck},
+    {"hasLegalMoves", passHasLegalMoves},
+    {"generateLegalMoves", passGenerateLegalMoves},
+    {"evaluateBoard", passEvaluateBoard},
+    {"computeZobristKey", passComputeZobristKey},
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+typedef struct {
+    int callsPerSample;
+    double medianNs;
+    double p99Ns;               // 99th percentile of the sample means, not of single calls
+    double cyclesPerCall;       // median, 0 without a time-stamp counter
+} BenchResult;
+
+static double nowNs() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const double *sorted, int count, double fraction) {
+    int rank = (int)(fraction * count + 0.999999);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static int runBenchmark(const Benchmark *bench, int reps, BenchResult *result) {
+    double *nanos = malloc((size_t)reps * sizeof(double));
+    double *cycles = malloc((size_t)reps * sizeof(double));
+    if (!nanos || !cycles) {
+        free(nanos);
+        free(cycles);
+        return 0;
+    }
+
+    for (int i = 0; i < WARMUP_PASSES; ++i) {
+        bench->pass();
+    }
+    for (int r = 0; r < reps; ++r) {
+        int calls = 0;
+        double start = nowNs();
+        unsigned long long startCycles = readCycles();
+        for (int i = 0; i < PASSES_PER_SAMPLE; ++i) {
+            calls += bench->pass();
+        }
+        unsigned long long elapsedCycles = readCycles() - startCycles;
+        nanos[r] = (nowNs() - start) / calls;
+        cycles[r] = (double)elapsedCycles / calls;
+        result->callsPerSample = calls;
+    }
+
+    qsort(nanos, (size_t)reps, sizeof(double), compareDoubles);
+    qsort(cycles, (size_t)reps, sizeof(double), compareDoubles);
+    result->medianNs = percentile(nanos, reps, 0.5);
+    result->p99Ns = percentile(nanos, reps, 0.99);
+    result->cyclesPerCall = HAVE_TSC ? percentile(cycles, reps, 0.5) : 0.0;
+    free(nanos);
+    free(cycles);
+    return 1;
+}
+
+static int writeJson(const char *filename, int reps, const BenchResult *results) {
+    FILE *out = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not open %s for writing\n", filename);
+        return 0;
+    }
+    fprintf(out, "{\n  \"positions\": %d,\n  \"repetitions\": %d,\n  \"benchmarks\": [\n", CORPUS_SIZE, reps);
+    for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+        fprintf(out, "    {\"name\": \"%s\", \"calls_per_sample\": %d, \"median_ns\": %.2f, "
+                     "\"p99_sample_mean_ns\": %.2f, \"cycles_per_call\": %.1f}%s\n",
+                benchmarks[i].name, results[i].callsPerSample, results[i].medianNs,
+                results[i].p99Ns, results[i].cyclesPerCall, i + 1 < BENCHMARK_COUNT ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 1;
+}
+
+// Positions searched by "c_chess_bench search": openings, middlegames, endgames and
+// move generator edge cases
+static const char *searchFens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2Q1RK1 b - - 0 9",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+    "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1",
+    "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1",
+    "5k2/8/8/8/8/8/8/4K2R w K - 0 1",
+    "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1",
+    "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1",
+    "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1",
+};
+
+#define SEARCH_BENCH_DEPTH 4
+
+// Search every bench position to a fixed depth on one thread and print the
+// node total, time and speed. Any change that should not alter the search
+// must leave the node total unchanged. Each position starts from an empty
+// transposition table, so the total depends on its size but not on the order
+// of the positions.
+static int runSearchBench(int depth, int hashMegabytes) {
+    int count = (int)(sizeof(searchFens) / sizeof(searchFens[0]));
+    unsigned long long totalNodes = 0;
+    struct timespec start, end;
+
+    if (!resizeTranspositionTable((size_t)hashMegabytes)) {
+        return 1;
+    }
+    timespec_get(&start, TIME_UTC);
+    for (int i = 0; i < count; ++i) {
+        Position pos;
+        SearchResult result;
+        if (!setPositionFromFen(&pos, searchFens[i])) {
+            fprintf(stderr, "Error: Could not parse bench position %d\n", i + 1);
+            return 1;
+        }
+        clearTranspositionTable();
+        searchPosition(&pos, depth, &result);
+        fprintf(stderr, "Position %d/%d: %llu nodes\n", i + 1, count, result.nodes);
+        totalNodes += result.nodes;
+    }
+    timespec_get(&end, TIME_UTC);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("===========================\n");
+    printf("Total time (ms) : %.0f\n", seconds * 1000);
+    printf("Nodes searched  : %llu\n", totalNodes);
+    printf("Nodes/second    : %.0f\n", seconds > 0 ? (double)totalNodes / seconds : 0.0);
+
+    TranspositionStats hash;
+    getTranspositionStats(&hash);
+    printf("Hash (MB)       : %zu\n", hash.bytes >> 20);
+    printf("Hash hits       : %.1f%% of %llu probes, %.1f%% cut off\n",
+           hash.probes ? 100.0 * (double)hash.hits / (double)hash.probes : 0.0, hash.probes,
+           hash.probes ? 100.0 * (double)hash.cutoffs / (double)hash.probes : 0.0);
+    printf("Hash full       : %.1f%%\n", hash.fillPermille / 10.0);
+    return 0;
+}
+
+// Median ns per call of each benchmark in a file written by --json, -1 for
+// benchmarks it does not list. Returns 0 if the file cannot be read.
+static int readBaseline(const char *filename, double *medians) {
+    FILE *in = fopen(filename, "r");
+    if (!in) {
+        fprintf(stderr, "Error: Could not open baseline %s\n", filename);
+        return 0;
+    }
+    for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+        medians[i] = -1;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), in)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *median = strstr(line, "\"median_ns\": ");
+        if (!name || !median) continue;
+        name += strlen("\"name\": \"");
+        for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+            size_t length = strlen(benchmarks[i].name);
+            if (strncmp(name, benchmarks[i].name, length) == 0 && name[length] == '"') {
+                medians[i] = atof(median + strlen("\"median_ns\": "));
+            }
+        }
+    }
+    fclose(in);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    // "search [depth] [hash MB]": deterministic search signature
+    if (argc > 1 && strcmp(argv[1], "search") == 0) {
+        int depth = argc > 2 ? atoi(argv[2]) : SEARCH_BENCH_DEPTH;
+        int hashMegabytes = argc > 3 ? atoi(argv[3]) : DEFAULT_HASH_MB;
+        return runSearchBench(depth > 0 ? depth : SEARCH_BENCH_DEPTH,
+                              hashMegabytes > 0 ? hashMegabytes : DEFAULT_HASH_MB);
+    }
+
+    int reps = DEFAULT_REPS;
+    const char *jsonFile = NULL;
+    const char *baselineFile = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselineFile = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+            tolerance = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--reps N] [--json <file>|-] [--baseline <file> [--tolerance percent]]\n"
+                            "       %s search [depth] [hash MB]\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    for (int p = 0; p < CORPUS_SIZE; ++p) {
+        if (!setPositionFromFen(&corpus[p], corpusFens[p])) {
+            fprintf(stderr, "Error: Could not parse corpus FEN \"%s\"\n", corpusFens[p]);
+            return 1;
+        }
+        generateLegalMoves(&corpus[p], corpus[p].sideToMove, &corpusMoves[p]);
+        // The early-exit test must agree with full generation
+        if (hasLegalMoves(&corpus[p], corpus[p].sideToMove) != (corpusMoves[p].count > 0)) {
+            fprintf(stderr, "Error: hasLegalMoves disagrees with generateLegalMoves on \"%s\"\n", corpusFens[p]);
+            return 1;
+        }
+    }
+
+    // Read before the run, which may overwrite the same file
+    double baseline[BENCHMARK_COUNT];
+    if (baselineFile && !readBaseline(baselineFile, baseline)) {
+        return 1;
+    }
+
+    // With JSON on stdout the table goes to stderr
+    FILE *table = jsonFile && strcmp(jsonFile, "-") == 0 ? stderr : stdout;
+    BenchResult results[BENCHMARK_COUNT];
+    fprintf(table, "%-22s %10s %10s %11s %12s%s\n", "benchmark", "calls", "median ns", "p99 mean ns", "cycles/call",
+            baselineFile ? "    vs baseline" : "");
+    int regressions = 0;
+    for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+        if (!runBenchmark(&benchmarks[i], reps, &results[i])) {
+            fprintf(stderr, "Error: Could not allocate samples for %s\n", benchmarks[i].name);
+            return 1;
+        }
+        fprintf(table, "%-22s %10d %10.1f %11.1f %12.1f", benchmarks[i].name, results[i].callsPerSample,
+               results[i].medianNs, results[i].p99Ns, results[i].cyclesPerCall);
+        if (baselineFile && baseline[i] > 0) {
+            double change = 100.0 * (results[i].medianNs / baseline[i] - 1.0);
+            int slower = change > tolerance;
+            regressions += slower;
+            fprintf(table, " %+13.1f%%%s", change, slower ? "  REGRESSION" : "");
+        }
+        fprintf(table, "\n");
+    }
+
+    if (jsonFile && !writeJson(jsonFile, reps, results)) {
+        return 1;
+    }
+    if (regressions) {
+        fprintf(stderr, "Error: %d benchmark(s) more than %.1f%% slower than %s\n", regressions, tolerance, baselineFile);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef C_CHESS_BITBOARD_H
+#define C_CHESS_BITBOARD_H
+
+#include "chess.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Index of the least significant set bit (bb must be non-zero)
+static inline int lsb(Bitboard bb) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx;
+    _BitScanForward64(&idx, bb);
+    return (int)idx;
+#else
+    return __builtin_ctzll(bb);
+#endif
+}
+
+// Remove and return the least significant set bit
+static inline int popLsb(Bitboard *bb) {
+    int sq = lsb(*bb);
+    *bb &= *bb - 1;
+    return sq;
+}
+
+static inline int popCount(Bitboard bb) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (int)__popcnt64(bb);
+#else
+    return __builtin_popcountll(bb);
+#endif
+}
+
+// Fancy magic bitboard entry for one square: the relevant occupancy mask is
+// multiplied by the magic and shifted down to index the square's attack table.
+typedef struct {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard *attacks;
+    unsigned shift;
+} Magic;
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+// Fill the slider attack tables, checking that no magic maps two occupancies
+// with different attacks to one slot. The first call builds them; calls from
+// other threads meanwhile wait for it, and later calls return at once.
+void initAttackTables(void);
+
+static inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    const Magic *m = &rookMagics[sq];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+static inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    const Magic *m = &bishopMagics[sq];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+static inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+#endif //C_CHESS_BITBOARD_H
@@ -1,49 +1,205 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <wchar.h>
 #include <locale.h>
 #include "chess.h"
+#include "bitboard.h"
+#include "geometry_tables.h"
+#include "profiler.h"
 
-// The board array
-wchar_t board[8][8];
+// The position played by the GUI and the console, plus its game record
+Position gamePosition;
+GameRecord gameRecord;
 
-// Move history
-char moveHistory[4096] = {0};
+// Glyph for each piece code, indexed by code
+static const wchar_t pieceGlyphs[13] = {
+    0,
+    white_king, white_queen, white_rook, white_bishop, white_knight, white_pawn,
+    black_king, black_queen, black_rook, black_bishop, black_knight, black_pawn
+};
 
-int whiteKingMoved = 0, whiteKingRookMoved = 0, whiteQueenRookMoved = 0;
-int blackKingMoved = 0, blackKingRookMoved = 0, blackQueenRookMoved = 0;
-int enPassantTargetRow = -1, enPassantTargetCol = -1;
+// Rebuild the piece and occupancy bitboards and the Zobrist key from the
+// mailbox (setup only; moves keep them up to date incrementally)
+void initBitboards(Position *pos) {
+    memset(pos->bitboards, 0, sizeof(pos->bitboards));
+    memset(pos->occupancy, 0, sizeof(pos->occupancy));
+    for (int sq = 0; sq < 64; ++sq) {
+        int piece = pos->squares[sq];
+        if (piece != NO_PIECE) {
+            toggleBitboards(pos, sq, piece);
+        }
+    }
+    pos->key = computeZobristKey(pos);
+}
+
+// Function to initialize a position with the standard starting setup
+void initPosition(Position *pos) {
+    static const uint8_t backRank[8] = {
+        W_ROOK, W_KNIGHT, W_BISHOP, W_QUEEN, W_KING, W_BISHOP, W_KNIGHT, W_ROOK
+    };
+
+    // Slider attack tables are shared by every position
+    initAttackTables();
 
-// Function to initialize the chess board with pieces
-void createBoard() {
     // Initialize the entire board to empty
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            board[row][col] = 0;
+    memset(pos, 0, sizeof(*pos));
+
+    // Set up pawns and other pieces; black mirrors white six codes higher
+    for (int col = 0; col < 8; col++) {
+        pos->squares[SQUARE(0, col)] = backRank[col];
+        pos->squares[SQUARE(1, col)] = W_PAWN;
+        pos->squares[SQUARE(6, col)] = B_PAWN;
+        pos->squares[SQUARE(7, col)] = backRank[col] + (B_KING - W_KING);
+    }
+
+    pos->castlingRights = CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE |
+                          CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE;
+    pos->enPassantSquare = -1;
+    pos->sideToMove = 1;
+    pos->fiftyMoveCounter = 0;
+    pos->record = NULL;
+    initBitboards(pos);
+}
+
+// Set up a position from Forsyth-Edwards Notation. The halfmove clock and
+// fullmove number are optional. Returns 1 on success, 0 if the FEN is malformed
+// (the position is then left in an unspecified state).
+int setPositionFromFen(Position *pos, const char *fen) {
+    static const char pieceLetters[] = "KQRBNPkqrbnp";
+    const char *p = fen;
+    int row = 7, col = 0;
+
+    initPosition(pos);
+    memset(pos->squares, 0, sizeof(pos->squares));
+
+    // Piece placement, rank 8 first
+    for (; *p && *p != ' '; ++p) {
+        if (*p == '/') {
+            if (col != 8 || row == 0) return 0;
+            row--;
+            col = 0;
+        } else if (*p >= '1' && *p <= '8') {
+            col += *p - '0';
+            if (col > 8) return 0;
+        } else {
+            const char *letter = strchr(pieceLetters, *p);
+            if (!letter || col >= 8) return 0;
+            pos->squares[SQUARE(row, col++)] = (uint8_t)(letter - pieceLetters + 1);
         }
     }
+    if (row != 0 || col != 8 || *p++ != ' ') return 0;
 
-    // Set up pawns
-    for (int col = 0; col < 8; col++) {
-        board[1][col] = white_pawn;
-        board[6][col] = black_pawn;
+    // Side to move
+    if (*p != 'w' && *p != 'b') return 0;
+    pos->sideToMove = *p++ == 'w';
+    if (*p++ != ' ') return 0;
+
+    // Castling rights
+    pos->castlingRights = 0;
+    if (*p == '-') {
+        p++;
+    } else {
+        for (; *p && *p != ' '; ++p) {
+            switch (*p) {
+                case 'K': pos->castlingRights |= CASTLE_WHITE_KINGSIDE; break;
+                case 'Q': pos->castlingRights |= CASTLE_WHITE_QUEENSIDE; break;
+                case 'k': pos->castlingRights |= CASTLE_BLACK_KINGSIDE; break;
+                case 'q': pos->castlingRights |= CASTLE_BLACK_QUEENSIDE; break;
+                default: return 0;
+            }
+        }
+    }
+    if (*p++ != ' ') return 0;
+
+    // En passant target square
+    pos->enPassantSquare = -1;
+    if (*p == '-') {
+        p++;
+    } else {
+        // The target is behind a pawn of the side that just moved
+        if (p[0] < 'a' || p[0] > 'h' || p[1] != (pos->sideToMove ? '6' : '3')) return 0;
+        pos->enPassantSquare = (int8_t)SQUARE(p[1] - '1', p[0] - 'a');
+        p += 2;
     }
 
-    // Set up other pieces
-    board[0][0] = board[0][7] = white_rook;
-    board[0][1] = board[0][6] = white_knight;
-    board[0][2] = board[0][5] = white_bishop;
-    board[0][3] = white_queen;
-    board[0][4] = white_king;
-
-    board[7][0] = board[7][7] = black_rook;
-    board[7][1] = board[7][6] = black_knight;
-    board[7][2] = board[7][5] = black_bishop;
-    board[7][3] = black_queen;
-    board[7][4] = black_king;
+    // Halfmove clock; the fullmove number is not tracked
+    pos->fiftyMoveCounter = 0;
+    if (*p == ' ') {
+        pos->fiftyMoveCounter = (uint16_t)strtoul(p + 1, NULL, 10);
+    }
+
+    // Drop any castling right whose king or rook has left its home square, as
+    // makeMove would have, so the key matches the same position reached by play
+    if (pos->squares[SQUARE(0, 4)] != W_KING) {
+        pos->castlingRights &= ~(CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE);
+    }
+    if (pos->squares[SQUARE(0, 7)] != W_ROOK) pos->castlingRights &= ~CASTLE_WHITE_KINGSIDE;
+    if (pos->squares[SQUARE(0, 0)] != W_ROOK) pos->castlingRights &= ~CASTLE_WHITE_QUEENSIDE;
+    if (pos->squares[SQUARE(7, 4)] != B_KING) {
+        pos->castlingRights &= ~(CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE);
+    }
+    if (pos->squares[SQUARE(7, 7)] != B_ROOK) pos->castlingRights &= ~CASTLE_BLACK_KINGSIDE;
+    if (pos->squares[SQUARE(7, 0)] != B_ROOK) pos->castlingRights &= ~CASTLE_BLACK_QUEENSIDE;
+
+    // initBitboards also computes the key from the masked rights
+    initBitboards(pos);
+    if (popCount(pos->bitboards[W_KING - 1]) != 1 || popCount(pos->bitboards[B_KING - 1]) != 1) {
+        return 0;
+    }
+
+    // Only keep an en passant target a pawn of the side to move can use, as
+    // makeMove does, so the key matches the same position reached by play.
+    // A target that is occupied or has no enemy pawn in front of it is invalid.
+    if (pos->enPassantSquare >= 0) {
+        int pushed = pos->enPassantSquare + (pos->sideToMove ? -8 : 8);
+        if (pos->squares[pos->enPassantSquare] != NO_PIECE ||
+            pos->squares[pushed] != (pos->sideToMove ? B_PAWN : W_PAWN)) {
+            return 0;
+        }
+        Bitboard pawns = pos->bitboards[pos->sideToMove ? W_PAWN - 1 : B_PAWN - 1];
+        if (!(PAWN_ATTACKS[pos->sideToMove ? OCC_BLACK : OCC_WHITE][pos->enPassantSquare] & pawns)) {
+            pos->enPassantSquare = -1;
+        }
+        pos->key = computeZobristKey(pos);
+    }
+    return 1;
+}
+
+// Reset the global game to the starting position with an empty record,
+// keeping the record's buffers for reuse
+void createBoard() {
+    gameRecord.moveCount = 0;
+    gameRecord.positions.count = 0;
+    gameRecord.historyLength = 0;
+    if (gameRecord.historyText) gameRecord.historyText[0] = '\0';
+    initPosition(&gamePosition);
+    gamePosition.record = &gameRecord;
+    recordPositionHash(&gamePosition);
+    PROFILE_RESET_GAME();
+}
+
+// Glyph of the piece on a square of the global game, 0 if empty
+wchar_t getBoardPiece(int row, int col) {
+    return pieceGlyphs[gamePosition.squares[SQUARE(row, col)]];
+}
+
+// Move history text of the global game, kept up to date as moves are recorded
+const char *getMoveHistory() {
+    return gameRecord.historyText ? gameRecord.historyText : "";
+}
+
+// Helper functions for piece identification (glyphs)
+int isPieceWhite(wchar_t piece) {
+    return piece >= white_king && piece <= white_pawn;
+}
+
+int isPieceBlack(wchar_t piece) {
+    return piece >= black_king && piece <= black_pawn;
 }
 
 // Function to print the chess board with borders and aligned rows/columns
-void printBoard() {
+void printBoard(const Position *pos) {
     // Print the column labels on top
     wprintf(L"     a   b   c   d   e   f   g   h  \n");
     wprintf(L"   ┌───┬───┬───┬───┬───┬───┬───┬───┐\n");
@@ -53,7 +209,7 @@ void printBoard() {
         wprintf(L" %d │", row + 1); // Row number and left border
 
         for (int col = 0; col < 8; col++) {
-            wchar_t piece = board[row][col];
+            wchar_t piece = pieceGlyphs[pos->squares[SQUARE(row, col)]];
             if (piece) {
                 wprintf(L" %lc ", piece);
             } else {
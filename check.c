@@ -4,145 +4,111 @@
 #include <string.h>
 #include <math.h>
 #include "chess.h"
+#include "bitboard.h"
+#include "movegen.h"
+#include "counters.h"
+#include "profiler.h"
 
 // Function to find the position of the king
-int findKing(int playerIsWhite, int *kingRow, int *kingCol) {
-    wchar_t kingPiece = playerIsWhite ? white_king : black_king;
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            if (board[row][col] == kingPiece) {
-                *kingRow = row;
-                *kingCol = col;
-                return 1;
-            }
-        }
+int findKing(const Position *pos, int playerIsWhite, int *kingRow, int *kingCol) {
+    Bitboard king = pos->bitboards[playerIsWhite ? W_KING - 1 : B_KING - 1];
+    if (!king) {
+        return 0; // King not found (should never happen in a valid game)
     }
-    return 0; // King not found (should never happen in a valid game)
+    int sq = lsb(king);
+    *kingRow = SQUARE_ROW(sq);
+    *kingCol = SQUARE_COL(sq);
+    return 1;
 }
 
 // Check if a king is in check
-int isKingInCheck(int playerIsWhite) {
+int isKingInCheck(const Position *pos, int playerIsWhite) {
+    COUNT_EVENT(COUNTER_KING_IN_CHECK);
     int kingRow, kingCol;
-    if (!findKing(playerIsWhite, &kingRow, &kingCol)) {
+    if (!findKing(pos, playerIsWhite, &kingRow, &kingCol)) {
         return 0; // No king found
     }
 
-    // Check if any opponent piece can legally move to the king's position
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            wchar_t piece = board[row][col];
-            if (piece == 0) continue; // Empty square
-            
-            // Only check opponent pieces
-            if ((playerIsWhite && isPieceBlack(piece)) || (!playerIsWhite && isPieceWhite(piece))) {
-                // Temporarily ignore the presence of the king for move validation
-                wchar_t savedKing = board[kingRow][kingCol];
-                board[kingRow][kingCol] = 0;
-                int canAttack = 0;
-                
-                // Check move validity based on piece type
-                if (piece == white_pawn || piece == black_pawn) {
-                    canAttack = isPawnMove(piece, row, col, kingRow, kingCol);
-                } else if (piece == white_rook || piece == black_rook) {
-                    canAttack = isRookMove(piece, row, col, kingRow, kingCol);
-                } else if (piece == white_knight || piece == black_knight) {
-                    canAttack = isKnightMove(piece, row, col, kingRow, kingCol);
-                } else if (piece == white_bishop || piece == black_bishop) {
-                    canAttack = isBishopMove(piece, row, col, kingRow, kingCol);
-                } else if (piece == white_queen || piece == black_queen) {
-                    canAttack = isQueenMove(piece, row, col, kingRow, kingCol);
-                } else if (piece == white_king || piece == black_king) {
-                    canAttack = isKingMove(piece, row, col, kingRow, kingCol);
-                }
-                
-                // Restore the king
-                board[kingRow][kingCol] = savedKing;
-                
-                // Special case for pawns which can only capture diagonally
-                if ((piece == white_pawn || piece == black_pawn) && col == kingCol) {
-                    canAttack = 0; // Pawns can't attack forward
-                }
-                
-                if (canAttack) {
-                    return 1; // King is in check
-                }
-            }
-        }
-    }
-    
-    return 0; // King is not in check
+    // The king is in check if any opponent piece attacks its square
+    return isSquareAttackedBB(pos, kingRow, kingCol, playerIsWhite);
 }
 
 // Check if a move would leave own king in check
-int moveWouldExposeCheck(int fromRow, int fromCol, int toRow, int toCol, int playerIsWhite) {
-    // Save current board state
-    wchar_t savedPiece = board[toRow][toCol];
-    wchar_t movedPiece = board[fromRow][fromCol];
-    
-    // Make the move temporarily
-    board[toRow][toCol] = movedPiece;
-    board[fromRow][fromCol] = 0;
+int moveWouldExposeCheck(const Position *pos, int fromRow, int fromCol, int toRow, int toCol, int playerIsWhite) {
+    // Make the move on a scratch copy so the caller's position is never touched
+    Position scratch = *pos;
+    Undo undo;
+    makeMove(&scratch, moveFromSquares(&scratch, SQUARE(fromRow, fromCol), SQUARE(toRow, toCol)), &undo);
     
     // Check if king is in check after this move
-    int inCheck = isKingInCheck(playerIsWhite);
-    
-    // Restore board state
-    board[fromRow][fromCol] = movedPiece;
-    board[toRow][toCol] = savedPiece;
-    
-    return inCheck;
+    return isKingInCheck(&scratch, playerIsWhite);
 }
 
-// Check if a player has any legal moves
-int hasLegalMoves(int playerIsWhite) {
-    // Check every possible move for the player
-    for (int fromRow = 0; fromRow < 8; fromRow++) {
-        for (int fromCol = 0; fromCol < 8; fromCol++) {
-            wchar_t piece = board[fromRow][fromCol];
-            
-            // Skip empty squares and opponent pieces
-            if (piece == 0 || (playerIsWhite && isPieceBlack(piece)) || (!playerIsWhite && isPieceWhite(piece))) {
-                continue;
-            }
-            
-            // Try every destination square
-            for (int toRow = 0; toRow < 8; toRow++) {
-                for (int toCol = 0; toCol < 8; toCol++) {
-                    // Skip if move is not valid according to piece rules
-                    if (!isValidMove(fromRow, fromCol, toRow, toCol)) {
-                        continue;
-                    }
-                    
-                    // Check if move would leave king in check
-                    if (!moveWouldExposeCheck(fromRow, fromCol, toRow, toCol, playerIsWhite)) {
-                        return 1; // Found at least one legal move
-                    }
-                }
-            }
-        }
+// Direct-mapped memo of recently seen positions, indexed by the low key bits.
+// The search evaluates the same leaf again as soon as it ends a line there.
+// One memo per thread, so searches on different threads never see each
+// other's half-written entries.
+#define STATUS_CACHE_SIZE 4096
+
+typedef struct {
+    uint64_t key;
+    uint8_t valid;
+    uint8_t inCheck;
+    uint8_t legalMoveCount;
+} StatusCacheEntry;
+
+static CHESS_THREAD_LOCAL StatusCacheEntry statusCache[STATUS_CACHE_SIZE];
+
+GameStatus getGameStatus(const Position *pos) {
+    PROFILE_ENTER(PHASE_STATUS);
+    StatusCacheEntry *entry = &statusCache[pos->key & (STATUS_CACHE_SIZE - 1)];
+    if (!entry->valid || entry->key != pos->key) {
+        MoveList list;
+        generateLegalMoves(pos, pos->sideToMove, &list);
+        entry->key = pos->key;
+        entry->valid = 1;
+        entry->inCheck = (uint8_t)isKingInCheck(pos, pos->sideToMove);
+        entry->legalMoveCount = (uint8_t)list.count;
     }
-    
-    return 0; // No legal moves found
+
+    GameStatus status;
+    status.key = pos->key;
+    status.inCheck = entry->inCheck;
+    status.legalMoveCount = entry->legalMoveCount;
+    status.checkmate = entry->inCheck && entry->legalMoveCount == 0;
+    status.stalemate = !entry->inCheck && entry->legalMoveCount == 0;
+    status.fiftyMoveDraw = (uint8_t)isFiftyMoveRuleDraw(pos);
+    status.repetitionDraw = (uint8_t)isThreefoldRepetition(pos);
+    PROFILE_LEAVE();
+    return status;
 }
 
 // Check if a player is in checkmate
-int isCheckMate(int playerIsWhite) {
+int isCheckMate(const Position *pos, int playerIsWhite) {
+    if (playerIsWhite == pos->sideToMove) {
+        return getGameStatus(pos).checkmate;
+    }
+
     // If the king is not in check, it's not checkmate
-    if (!isKingInCheck(playerIsWhite)) {
+    if (!isKingInCheck(pos, playerIsWhite)) {
         return 0;
     }
     
     // If there are legal moves, it's not checkmate
-    return !hasLegalMoves(playerIsWhite);
+    return !hasLegalMoves(pos, playerIsWhite);
 }
 
 // Check if a player is in stalemate
-int isStaleMate(int playerIsWhite) {
+int isStaleMate(const Position *pos, int playerIsWhite) {
+    if (playerIsWhite == pos->sideToMove) {
+        return getGameStatus(pos).stalemate;
+    }
+
     // If the king is in check, it's not stalemate
-    if (isKingInCheck(playerIsWhite)) {
+    if (isKingInCheck(pos, playerIsWhite)) {
         return 0;
     }
     
     // If there are legal moves, it's not stalemate
-    return !hasLegalMoves(playerIsWhite);
+    return !hasLegalMoves(pos, playerIsWhite);
 }
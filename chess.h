@@ -2,8 +2,17 @@
 #define C_CHESS_CHESS_H
 
 #include <wchar.h>
+#include <stdint.h>
+#include "zobrist_keys.h"
 
-// Piece definitions
+// Storage class for per-thread instrumentation state
+#ifdef _MSC_VER
+#define CHESS_THREAD_LOCAL __declspec(thread)
+#else
+#define CHESS_THREAD_LOCAL _Thread_local
+#endif
+
+// Piece glyphs (used for display and by the GUI/PGN compatibility layer)
 #define white_king   0x2654 // ♔
 #define white_queen  0x2655 // ♕
 #define white_rook   0x2656 // ♖
@@ -17,70 +26,234 @@
 #define black_knight  0x265E // ♞
 #define black_pawn   0x265F // ♟
 
-// The global board
-extern wchar_t board[8][8];
-
-// Global move history
-extern char moveHistory[4096];
+// 1-byte piece codes stored in Position.squares. Code - 1 is the bitboard index.
+enum {
+    NO_PIECE = 0,
+    W_KING, W_QUEEN, W_ROOK, W_BISHOP, W_KNIGHT, W_PAWN,
+    B_KING, B_QUEEN, B_ROOK, B_BISHOP, B_KNIGHT, B_PAWN
+};
 
-// Add castling and en passant tracking variables
-extern int whiteKingMoved, whiteKingRookMoved, whiteQueenRookMoved;
-extern int blackKingMoved, blackKingRookMoved, blackQueenRookMoved;
-extern int enPassantTargetRow, enPassantTargetCol;
+#define PIECE_IS_WHITE(p) ((p) >= W_KING && (p) <= W_PAWN)
+#define PIECE_IS_BLACK(p) ((p) >= B_KING && (p) <= B_PAWN)
 
-// 50-move rule counter
-extern int fiftyMoveCounter;
+// Squares are indexed row * 8 + col, row 0 being rank 1
+#define SQUARE(row, col) ((row) * 8 + (col))
+#define SQUARE_ROW(sq) ((sq) >> 3)
+#define SQUARE_COL(sq) ((sq) & 7)
 
-// Threefold repetition
-#define MAX_REPETITIONS 512
-extern unsigned long long positionHashes[MAX_REPETITIONS];
-extern int repetitionCount;
-unsigned long long computeBoardHash();
-void recordPositionHash();
-int isThreefoldRepetition();
+// Castling rights bits
+#define CASTLE_WHITE_KINGSIDE  1
+#define CASTLE_WHITE_QUEENSIDE 2
+#define CASTLE_BLACK_KINGSIDE  4
+#define CASTLE_BLACK_QUEENSIDE 8
 
 // --- Bitboard representation for speed optimization ---
 typedef unsigned long long Bitboard;
-extern Bitboard bitboards[12]; // 0-5: white, 6-11: black (K,Q,R,B,N,P)
-void updateBitboards();
-void initBitboards();
-int isSquareOccupied(int row, int col);
-int isSquareAttackedBB(int row, int col, int defenderIsWhite);
 
-// Board manipulation and movement functions
+// Indices into Position.occupancy
+#define OCC_WHITE 0
+#define OCC_BLACK 1
+#define OCC_ALL   2
+
+// Moves are packed into 16 bits: from square (bits 0-5), to square (6-11)
+// and a 4-bit kind (12-15). Capture kinds have bit 2 set, promotions bit 3;
+// the low two bits of a promotion select knight, bishop, rook or queen.
+typedef uint16_t Move;
+
+#define MOVE_NONE 0                 // a1a1, never a real move
+
+#define MOVE_QUIET            0
+#define MOVE_DOUBLE_PUSH      1
+#define MOVE_KING_CASTLE      2
+#define MOVE_QUEEN_CASTLE     3
+#define MOVE_CAPTURE          4
+#define MOVE_EN_PASSANT       5
+#define MOVE_PROMOTION        8     // + 0..3 for N, B, R, Q; + MOVE_CAPTURE when taking
+
+#define ENCODE_MOVE(from, to, kind) ((Move)((from) | ((to) << 6) | ((kind) << 12)))
+#define MOVE_FROM(m) ((m) & 63)
+#define MOVE_TO(m)   (((m) >> 6) & 63)
+#define MOVE_KIND(m) ((m) >> 12)
+#define MOVE_IS_CAPTURE(m)   ((MOVE_KIND(m) & MOVE_CAPTURE) != 0)
+#define MOVE_IS_PROMOTION(m) ((MOVE_KIND(m) & MOVE_PROMOTION) != 0)
+#define MOVE_IS_CASTLE(m)    (MOVE_KIND(m) == MOVE_KING_CASTLE || MOVE_KIND(m) == MOVE_QUEEN_CASTLE)
+
+// Piece code a promotion turns into (queen, rook, bishop and knight codes
+// run in reverse order of the kind's low bits)
+static inline int movePromotionPiece(Move m, int whiteMove) {
+    return (whiteMove ? W_QUEEN : B_QUEEN) + 3 - (MOVE_KIND(m) & 3);
+}
+
+// Zobrist keys of the positions reached, oldest first. Grows without limit;
+// repetition scans only look back as far as the last irreversible move.
+typedef struct HashHistory {
+    uint64_t *keys;
+    int count;
+    int capacity;
+} HashHistory;
+
+// Game-level record that outlives a single position: every move played with
+// its text, and the key of every position reached, starting with the initial
+// one. Search copies do not carry one. A move's text is written once, as it is
+// recorded, so describing the game never replays it.
+typedef struct GameRecord {
+    Move *moves;
+    char (*moveTexts)[8];           // formatMove text of each move
+    int moveCount;
+    int moveCapacity;
+    char *historyText;              // the move texts, each followed by a space
+    size_t historyLength;
+    HashHistory positions;
+} GameRecord;
+
+// Everything needed to describe and play on from a position. The mailbox fills
+// exactly one cache line, so any number of positions can live side by side
+// (two games, two searches, one per thread).
+typedef struct Position {
+    _Alignas(64) uint8_t squares[64];   // piece code per square
+    Bitboard bitboards[12];             // 0-5: white, 6-11: black (K,Q,R,B,N,P)
+    Bitboard occupancy[3];              // white, black and all pieces
+    uint8_t castlingRights;             // CASTLE_* bits still available
+    int8_t enPassantSquare;             // square a pawn may capture onto, or -1
+    uint8_t sideToMove;                 // 1 = white, 0 = black
+    uint16_t fiftyMoveCounter;          // half-moves since last pawn move or capture
+    uint64_t key;                       // Zobrist key, updated incrementally
+    GameRecord *record;                 // NULL for scratch/search positions
+} Position;
+
+// The position the GUI, console and save/load code play on
+extern Position gamePosition;
+extern GameRecord gameRecord;
+
+// Position setup
+void initPosition(Position *pos);
+void initBitboards(Position *pos);
+int setPositionFromFen(Position *pos, const char *fen);
+
+// Incremental board updates: keep the mailbox, piece bitboards, occupancy
+// sets and Zobrist key in step with a single XOR per set.
+static inline void toggleBitboards(Position *pos, int sq, int piece) {
+    Bitboard bit = 1ULL << sq;
+    pos->bitboards[piece - 1] ^= bit;
+    pos->occupancy[PIECE_IS_WHITE(piece) ? OCC_WHITE : OCC_BLACK] ^= bit;
+    pos->occupancy[OCC_ALL] ^= bit;
+    pos->key ^= ZOBRIST_PIECE[piece - 1][sq];
+}
+
+static inline void putPiece(Position *pos, int sq, int piece) {
+    pos->squares[sq] = (uint8_t)piece;
+    toggleBitboards(pos, sq, piece);
+}
+
+static inline void removePiece(Position *pos, int sq) {
+    toggleBitboards(pos, sq, pos->squares[sq]);
+    pos->squares[sq] = NO_PIECE;
+}
+
+static inline void movePiece(Position *pos, int from, int to) {
+    int piece = pos->squares[from];
+    Bitboard delta = (1ULL << from) | (1ULL << to);
+    pos->bitboards[piece - 1] ^= delta;
+    pos->occupancy[PIECE_IS_WHITE(piece) ? OCC_WHITE : OCC_BLACK] ^= delta;
+    pos->occupancy[OCC_ALL] ^= delta;
+    pos->key ^= ZOBRIST_PIECE[piece - 1][from] ^ ZOBRIST_PIECE[piece - 1][to];
+    pos->squares[to] = (uint8_t)piece;
+    pos->squares[from] = NO_PIECE;
+}
+
+// --- Compatibility layer for gui.c / saveload.c / api.c ---
+// These operate on gamePosition and speak in wchar_t glyphs.
 void createBoard();
-void printBoard();
-int readMove(int *fromRow, int *fromCol, int *toRow, int *toCol);
-int isValidMove(int fromRow, int fromCol, int toRow, int toCol);
-void executeMove(int fromRow, int fromCol, int toRow, int toCol);
-int isPawnMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isRookMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isKnightMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isBishopMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isQueenMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isKingMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol);
-int isPathClear(int fromRow, int fromCol, int toRow, int toCol);
+wchar_t getBoardPiece(int row, int col);
+const char *getMoveHistory();
 int isPieceWhite(wchar_t piece);
 int isPieceBlack(wchar_t piece);
-void recordMove(int fromRow, int fromCol, int toRow, int toCol);
-void printMoveHistory();
+
+// Position hashing and threefold repetition
+uint64_t computeZobristKey(const Position *pos);
+unsigned long long computeBoardHash(const Position *pos);
+void recordPositionHash(Position *pos);
+int isThreefoldRepetition(const Position *pos);
+
+// Repetition detection on a key stack, shared by the game record and search.
+// A push never fails (running out of memory aborts), so every pop matches one.
+void pushPositionKey(HashHistory *history, uint64_t key);
+static inline void popPositionKey(HashHistory *history) {
+    history->count--;
+}
+int isRepetition(const HashHistory *history, int fiftyMoveCounter);
+
+int isSquareOccupied(const Position *pos, int row, int col);
+int isSquareAttackedBB(const Position *pos, int row, int col, int defenderIsWhite);
+
+// Board manipulation and movement functions
+void printBoard(const Position *pos);
+int readMove(int *fromRow, int *fromCol, int *toRow, int *toCol);
+int isValidMove(const Position *pos, int fromRow, int fromCol, int toRow, int toCol);
+void executeMove(Position *pos, int fromRow, int fromCol, int toRow, int toCol);
+void playMove(Position *pos, Move m);
+int isPawnMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isRookMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isKnightMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isBishopMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isQueenMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isKingMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol);
+int isPathClear(const Position *pos, int fromRow, int fromCol, int toRow, int toCol);
+void recordMove(Position *pos, Move m);
+void formatMove(const Position *pos, Move m, char out[8]);
+void formatRecordedMove(const GameRecord *record, int index, char out[8]);
+void printMoveHistory(const Position *pos);
+
+// Fixed-depth principal variation search of the side to move. The result
+// depends only on the position, its game record, the depth and what the
+// transposition table holds; from a cleared table the node count doubles as
+// a signature of the search.
+typedef struct {
+    Move bestMove;                  // MOVE_NONE if there is no legal move
+    int score;                      // white's point of view; mate in n plies is MATE_SCORE - n
+    unsigned long long nodes;
+} SearchResult;
+
+void searchPosition(const Position *pos, int maxDepth, SearchResult *result);
 
 // Local CPU (minimax) move function
-void getLocalCPUMove(int *fromRow, int *fromCol, int *toRow, int *toCol);
+Move getLocalCPUMove(const Position *pos);
+
+// Score of a checkmate in evaluateBoard (white's point of view)
+#define MATE_SCORE 100000
 
 // Static evaluation function
-int evaluateBoard();
+int evaluateBoard(const Position *pos);
 
 // Check-related functions (defined in check.c)
-int findKing(int playerIsWhite, int *kingRow, int *kingCol);
-int isKingInCheck(int playerIsWhite);
-int moveWouldExposeCheck(int fromRow, int fromCol, int toRow, int toCol, int playerIsWhite);
-int hasLegalMoves(int playerIsWhite);
-int isCheckMate(int playerIsWhite);
-int isStaleMate(int playerIsWhite);
+int findKing(const Position *pos, int playerIsWhite, int *kingRow, int *kingCol);
+int isKingInCheck(const Position *pos, int playerIsWhite);
+int moveWouldExposeCheck(const Position *pos, int fromRow, int fromCol, int toRow, int toCol, int playerIsWhite);
+int isCheckMate(const Position *pos, int playerIsWhite);
+int isStaleMate(const Position *pos, int playerIsWhite);
+
+// Everything the game loop, evaluation and GUI ask about the side to move.
+// Check and move count follow from the key alone and are memoised against it
+// in a per-thread memo. The draw-by-rule flags are not memoised: they are
+// worked out again on every call, and the repetition flag is always 0 for a
+// position without a game record, such as the search's copies.
+typedef struct GameStatus {
+    uint64_t key;           // position the status describes
+    uint8_t inCheck;
+    uint8_t legalMoveCount; // never more than 218
+    uint8_t checkmate;
+    uint8_t stalemate;
+    uint8_t fiftyMoveDraw;
+    uint8_t repetitionDraw; // threefold, only known for the game position
+} GameStatus;
+
+GameStatus getGameStatus(const Position *pos);
+
+// Early-exit legal move test (defined in movegen.c)
+int hasLegalMoves(const Position *pos, int playerIsWhite);
 
 // Function to check for 50-move rule draw
-int isFiftyMoveRuleDraw();
+int isFiftyMoveRuleDraw(const Position *pos);
 
 // Save/Load functions
 int saveGame(const char* filename);
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "counters.h"
+
+static const char *counterNames[COUNTER_COUNT] = {
+    "nodes",
+    "legal_movegen_calls",
+    "king_in_check_calls",
+    "beta_cutoffs",
+    "first_move_cutoffs",
+    "evaluations",
+    "repetition_probes",
+    "hash_probes",
+    "hash_hits",
+    "hash_cutoffs",
+};
+
+#ifdef CHESS_COUNTERS
+CHESS_THREAD_LOCAL CounterBlock *threadCounters;
+
+// Every block ever registered. Blocks are never freed, so the counts of
+// threads that have finished still show up in the totals.
+static _Atomic(CounterBlock *) counterBlocks;
+
+CounterBlock *registerCounterBlock() {
+    CounterBlock *block = calloc(1, sizeof(CounterBlock));
+    if (!block) {
+        fprintf(stderr, "Error: Could not allocate event counters\n");
+        abort();
+    }
+    block->next = atomic_load(&counterBlocks);
+    while (!atomic_compare_exchange_weak(&counterBlocks, &block->next, block)) {
+    }
+    threadCounters = block;
+    return block;
+}
+
+void snapshotCounters(CounterSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (CounterBlock *block = atomic_load(&counterBlocks); block; block = block->next) {
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            snapshot->values[i] += atomic_load_explicit(&block->values[i], memory_order_relaxed);
+        }
+    }
+}
+#else
+void snapshotCounters(CounterSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+#endif
+
+// Space left in an output buffer after length characters, as snprintf counts
+static size_t room(int length, size_t size) {
+    return (size_t)length < size ? size - (size_t)length : 0;
+}
+
+static int formatCounterObject(char *out, size_t size, const unsigned long long *values) {
+    int length = snprintf(out, size, "{");
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        length += snprintf(out + length, room(length, size),
+                           "%s\"%s\": %llu", i ? ", " : "", counterNames[i], values[i]);
+    }
+    length += snprintf(out + length, room(length, size), "}");
+    return length;
+}
+
+int formatCountersJson(char *out, size_t size, const char *label, const CounterSnapshot *since) {
+    CounterSnapshot now;
+    int length;
+
+    snapshotCounters(&now);
+    length = snprintf(out, size, "{\"label\": \"%s\"", label);
+    if (since) {
+        unsigned long long delta[COUNTER_COUNT];
+        for (int i = 0; i < COUNTER_COUNT; ++i) {
+            delta[i] = now.values[i] - since->values[i];
+        }
+        length += snprintf(out + length, room(length, size), ", \"search\": ");
+        length += formatCounterObject(out + length, room(length, size), delta);
+    }
+    length += snprintf(out + length, room(length, size), ", \"total\": ");
+    length += formatCounterObject(out + length, room(length, size), now.values);
+    length += snprintf(out + length, room(length, size), "}");
+    return length;
+}
+
+void dumpCounters(const char *label, const CounterSnapshot *since) {
+#ifdef CHESS_COUNTERS
+    char json[1024];
+    const char *filename = getenv("CHESS_COUNTERS_FILE");
+    FILE *out = filename ? fopen(filename, "a") : stderr;
+    if (!out) {
+        fprintf(stderr, "Error: Could not open %s for counters\n", filename);
+        return;
+    }
+    formatCountersJson(json, sizeof(json), label, since);
+    fprintf(out, "%s\n", json);
+    if (out != stderr) fclose(out);
+#else
+    (void)label;
+    (void)since;
+#endif
+}
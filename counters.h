@@ -0,0 +1,68 @@
+#ifndef C_CHESS_COUNTERS_H
+#define C_CHESS_COUNTERS_H
+
+#include <stddef.h>
+#include "chess.h"
+
+// Hot-path event counters. Built in only with CHESS_COUNTERS defined (CMake
+// option of the same name); otherwise COUNT_EVENT compiles to nothing and the
+// report functions see zeros.
+typedef enum {
+    COUNTER_NODES,              // search nodes, every root pass included
+    COUNTER_LEGAL_MOVEGEN,      // generateLegalMoves calls
+    COUNTER_KING_IN_CHECK,      // isKingInCheck calls
+    COUNTER_BETA_CUTOFFS,
+    COUNTER_FIRST_MOVE_CUTOFFS, // cutoffs caused by the first move searched
+    COUNTER_EVALUATIONS,        // evaluateBoard calls
+    COUNTER_REPETITION_PROBES,  // isRepetition calls
+    COUNTER_HASH_PROBES,        // transposition table probes
+    COUNTER_HASH_HITS,          // probes that found the position
+    COUNTER_HASH_CUTOFFS,       // hits that answered the node without a search
+    COUNTER_COUNT
+} CounterId;
+
+// Totals over every thread at one moment
+typedef struct {
+    unsigned long long values[COUNTER_COUNT];
+} CounterSnapshot;
+
+#ifdef CHESS_COUNTERS
+#include <stdatomic.h>
+
+// One block per thread, padded so no two threads write the same cache line.
+// Only the owning thread writes; relaxed atomics let reports read it safely.
+typedef struct CounterBlock {
+    char padBefore[64];
+    _Atomic unsigned long long values[COUNTER_COUNT];
+    struct CounterBlock *next;
+    char padAfter[64];
+} CounterBlock;
+
+extern CHESS_THREAD_LOCAL CounterBlock *threadCounters;
+CounterBlock *registerCounterBlock();
+
+static inline void countEvent(CounterId id) {
+    CounterBlock *block = threadCounters ? threadCounters : registerCounterBlock();
+    unsigned long long value = atomic_load_explicit(&block->values[id], memory_order_relaxed);
+    atomic_store_explicit(&block->values[id], value + 1, memory_order_relaxed);
+}
+
+#define COUNT_EVENT(id) countEvent(id)
+#else
+#define COUNT_EVENT(id) ((void)0)
+#endif
+
+// Sum the counters of every thread that has counted anything
+void snapshotCounters(CounterSnapshot *snapshot);
+
+// One-line JSON object: {"label": ..., "search": {...}, "total": {...}}.
+// "search" holds the counts since the given snapshot and is left out when
+// since is NULL. Returns the length written, as snprintf.
+int formatCountersJson(char *out, size_t size, const char *label, const CounterSnapshot *since);
+
+// Append formatCountersJson output as a line to the file named by the
+// CHESS_COUNTERS_FILE environment variable, or to stderr. No-op unless
+// counters are built in.
+void dumpCounters(const char *label, const CounterSnapshot *since);
+
+#endif //C_CHESS_COUNTERS_H
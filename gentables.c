@@ -0,0 +1,181 @@
+// Build-time generator for the board geometry tables and Zobrist keys.
+// Usage: gentables <geometry header> <zobrist header>
+// Emits static const lookup tables so the engine pays nothing at startup.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef unsigned long long Bitboard;
+
+static int onBoard(int row, int col) {
+    return row >= 0 && row < 8 && col >= 0 && col < 8;
+}
+
+static Bitboard leaperAttacks(int sq, const int offsets[][2], int count) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < count; ++i) {
+        int row = sq / 8 + offsets[i][0];
+        int col = sq % 8 + offsets[i][1];
+        if (onBoard(row, col)) attacks |= 1ULL << (row * 8 + col);
+    }
+    return attacks;
+}
+
+// Step direction from a to b if they share a rank, file or diagonal, else 0
+static int alignment(int a, int b, int *rowStep, int *colStep) {
+    int dr = b / 8 - a / 8, dc = b % 8 - a % 8;
+    if (a == b) return 0;
+    if (dr != 0 && dc != 0 && abs(dr) != abs(dc)) return 0;
+    *rowStep = (dr > 0) - (dr < 0);
+    *colStep = (dc > 0) - (dc < 0);
+    return 1;
+}
+
+static Bitboard between(int a, int b) {
+    int rs, cs;
+    Bitboard squares = 0;
+    if (!alignment(a, b, &rs, &cs)) return 0;
+    for (int row = a / 8 + rs, col = a % 8 + cs; row * 8 + col != b; row += rs, col += cs) {
+        squares |= 1ULL << (row * 8 + col);
+    }
+    return squares;
+}
+
+static Bitboard line(int a, int b) {
+    int rs, cs;
+    Bitboard squares = 0;
+    if (!alignment(a, b, &rs, &cs)) return 0;
+    // Extend in both directions from a to the board edges
+    for (int dir = -1; dir <= 1; dir += 2) {
+        for (int row = a / 8, col = a % 8; onBoard(row, col); row += dir * rs, col += dir * cs) {
+            squares |= 1ULL << (row * 8 + col);
+        }
+    }
+    return squares;
+}
+
+// Deterministic xorshift64* stream so every build hashes positions identically
+static Bitboard nextRandom(Bitboard *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// Tables are written as rows of 64 entries; multi-row tables get inner braces
+static void writeBitboards(FILE *out, const char *type, const char *decl, const Bitboard *values, int rows) {
+    fprintf(out, "static const %s %s = {\n", type, decl);
+    for (int r = 0; r < rows; ++r) {
+        if (rows > 1) fprintf(out, "  {\n");
+        for (int i = 0; i < 64; ++i) {
+            fprintf(out, "%s0x%016llXULL,%s", i % 4 == 0 ? "    " : " ", values[r * 64 + i], i % 4 == 3 ? "\n" : "");
+        }
+        if (rows > 1) fprintf(out, "  },\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+static void writeBytes(FILE *out, const char *decl, const unsigned char *values, int rows) {
+    fprintf(out, "static const unsigned char %s = {\n", decl);
+    for (int r = 0; r < rows; ++r) {
+        fprintf(out, "  {");
+        for (int i = 0; i < 64; ++i) {
+            fprintf(out, "%s%d,", i % 16 == 0 ? "\n    " : " ", values[r * 64 + i]);
+        }
+        fprintf(out, "\n  },\n");
+    }
+    fprintf(out, "};\n\n");
+}
+
+int main(int argc, char **argv) {
+    static const int knightOffsets[8][2] = {
+        {2, 1}, {1, 2}, {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}, {1, -2}, {2, -1}
+    };
+    static const int kingOffsets[8][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}
+    };
+    static const int pawnOffsets[2][2][2] = {
+        {{1, -1}, {1, 1}},   // white pawns capture towards rank 8
+        {{-1, -1}, {-1, 1}}  // black pawns capture towards rank 1
+    };
+    static Bitboard knight[64], king[64], pawn[2 * 64], betweenTable[64 * 64], lineTable[64 * 64];
+    static unsigned char chebyshev[64 * 64], manhattan[64 * 64];
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <geometry header> <zobrist header>\n", argv[0]);
+        return 1;
+    }
+
+    for (int a = 0; a < 64; ++a) {
+        knight[a] = leaperAttacks(a, knightOffsets, 8);
+        king[a] = leaperAttacks(a, kingOffsets, 8);
+        pawn[a] = leaperAttacks(a, pawnOffsets[0], 2);
+        pawn[64 + a] = leaperAttacks(a, pawnOffsets[1], 2);
+        for (int b = 0; b < 64; ++b) {
+            int dr = abs(a / 8 - b / 8), dc = abs(a % 8 - b % 8);
+            betweenTable[a * 64 + b] = between(a, b);
+            lineTable[a * 64 + b] = line(a, b);
+            chebyshev[a * 64 + b] = (unsigned char)(dr > dc ? dr : dc);
+            manhattan[a * 64 + b] = (unsigned char)(dr + dc);
+        }
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not create %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by gentables.c at build time. Do not edit.\n");
+    fprintf(out, "#ifndef C_CHESS_GEOMETRY_TABLES_H\n#define C_CHESS_GEOMETRY_TABLES_H\n\n");
+    fprintf(out, "#include \"chess.h\"\n\n");
+    fprintf(out, "// Squares attacked by a knight / king standing on each square\n");
+    writeBitboards(out, "Bitboard", "KNIGHT_ATTACKS[64]", knight, 1);
+    writeBitboards(out, "Bitboard", "KING_ATTACKS[64]", king, 1);
+    fprintf(out, "// Squares attacked by a pawn on each square, [OCC_WHITE] or [OCC_BLACK]\n");
+    writeBitboards(out, "Bitboard", "PAWN_ATTACKS[2][64]", pawn, 2);
+    fprintf(out, "// Squares strictly between two aligned squares, 0 if not aligned\n");
+    writeBitboards(out, "Bitboard", "BETWEEN[64][64]", betweenTable, 64);
+    fprintf(out, "// Whole rank, file or diagonal through two aligned squares, 0 if not aligned\n");
+    writeBitboards(out, "Bitboard", "LINE[64][64]", lineTable, 64);
+    fprintf(out, "// King-move (Chebyshev) and rook-path (Manhattan) distances\n");
+    writeBytes(out, "SQUARE_DISTANCE[64][64]", chebyshev, 64);
+    writeBytes(out, "MANHATTAN_DISTANCE[64][64]", manhattan, 64);
+    fprintf(out, "#endif //C_CHESS_GEOMETRY_TABLES_H\n");
+    fclose(out);
+
+    // Zobrist keys: one per piece/square, castling-rights set and en passant file,
+    // plus one for black to move
+    static Bitboard pieceKeys[12 * 64], castlingKeys[16], enPassantKeys[8];
+    Bitboard state = 0x2545F4914F6CDD1DULL;
+    for (int i = 0; i < 12 * 64; ++i) pieceKeys[i] = nextRandom(&state);
+    for (int i = 0; i < 16; ++i) castlingKeys[i] = i ? nextRandom(&state) : 0;
+    for (int i = 0; i < 8; ++i) enPassantKeys[i] = nextRandom(&state);
+    Bitboard sideKey = nextRandom(&state);
+
+    out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Error: Could not create %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(out, "// Generated by gentables.c at build time. Do not edit.\n");
+    fprintf(out, "#ifndef C_CHESS_ZOBRIST_KEYS_H\n#define C_CHESS_ZOBRIST_KEYS_H\n\n");
+    fprintf(out, "#include <stdint.h>\n\n");
+    fprintf(out, "// Indexed [piece code - 1][square]\n");
+    writeBitboards(out, "uint64_t", "ZOBRIST_PIECE[12][64]", pieceKeys, 12);
+    fprintf(out, "// Indexed by the CASTLE_* rights mask; no rights hashes to 0\n");
+    fprintf(out, "static const uint64_t ZOBRIST_CASTLING[16] = {\n");
+    for (int i = 0; i < 16; ++i) {
+        fprintf(out, "%s0x%016llXULL,%s", i % 4 == 0 ? "    " : " ", castlingKeys[i], i % 4 == 3 ? "\n" : "");
+    }
+    fprintf(out, "};\n\n// Indexed by the file of the en passant square\n");
+    fprintf(out, "static const uint64_t ZOBRIST_EN_PASSANT[8] = {\n");
+    for (int i = 0; i < 8; ++i) {
+        fprintf(out, "%s0x%016llXULL,%s", i % 4 == 0 ? "    " : " ", enPassantKeys[i], i % 4 == 3 ? "\n" : "");
+    }
+    fprintf(out, "};\n\n// XORed in when black is to move\n");
+    fprintf(out, "#define ZOBRIST_SIDE 0x%016llXULL\n\n", sideKey);
+    fprintf(out, "#endif //C_CHESS_ZOBRIST_KEYS_H\n");
+    fclose(out);
+    return 0;
+}
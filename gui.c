@@ -5,6 +5,8 @@
 #include "gui.h"   // Assuming gui.h contains function prototypes for gui
 #include "api.h"   // Added to support one-player AI move
 #include "saveload.h"  // Added for saveGame and loadGame functions
+#include "counters.h"
+#include "uilatency.h"
 
 #define BOARD_SIZE 8
 #define MAX_AI_RETRIES 3  // Maximum number of retry attempts
@@ -30,8 +32,6 @@ static GtkWidget *evalLabel = NULL;
 
 // Forward declaration for local AI move
 static gboolean process_local_cpu_move(gpointer data);
-// Forward declaration for evaluateBoard
-int evaluateBoard(void);
 
 // Function to display check message
 static void show_check_message(GtkWindow *parent, int currentPlayerInCheck) {
@@ -118,7 +118,7 @@ static void refresh_board() {
             // Ensure the button is clickable
             gtk_widget_set_sensitive(buttons[row][col], TRUE);
             // Get the piece from the board array (inverted row for display)
-            wchar_t piece = board[7 - row][col];
+            wchar_t piece = getBoardPiece(7 - row, col);
 
             // Get the style context for the button
             GtkStyleContext *context = gtk_widget_get_style_context(buttons[row][col]);
@@ -168,8 +168,9 @@ static void refresh_board() {
 
     // Check for special game states and display relevant messages
     GtkWindow *parent = GTK_WINDOW(gtk_widget_get_toplevel(buttons[0][0]));
+    GameStatus status = getGameStatus(&gamePosition);
 
-    if (stalemateFlag && isFiftyMoveRuleDraw()) {
+    if (stalemateFlag && status.fiftyMoveDraw) {
         // 50-move rule draw
         for (int r = 0; r < BOARD_SIZE; r++) {
             for (int c = 0; c < BOARD_SIZE; c++) {
@@ -179,7 +180,7 @@ static void refresh_board() {
         show_fifty_move_draw_message(parent);
         stalemateFlag = 0;
     }
-    else if (stalemateFlag && isThreefoldRepetition()) {
+    else if (stalemateFlag && status.repetitionDraw) {
         // Threefold repetition draw
         for (int r = 0; r < BOARD_SIZE; r++) {
             for (int c = 0; c < BOARD_SIZE; c++) {
@@ -217,12 +218,12 @@ static void refresh_board() {
 
     // --- Static evaluation display ---
     if (evalLabel) {
-        int eval = evaluateBoard();
+        int eval = evaluateBoard(&gamePosition);
         int whiteScore = 0, blackScore = 0;
         // Calculate scores for each side
         for (int row = 0; row < 8; ++row) {
             for (int col = 0; col < 8; ++col) {
-                wchar_t piece = board[row][col];
+                wchar_t piece = getBoardPiece(row, col);
                 switch (piece) {
                     case white_pawn:   whiteScore += 100; break;
                     case white_knight: whiteScore += 320; break;
@@ -258,11 +259,11 @@ static void refresh_board() {
 // Process AI move in a separate function to ensure UI responsiveness
 static gboolean process_ai_move(gpointer data) {
     int aiFromRow, aiFromCol, aiToRow, aiToCol;
-    int success = getBlackMove(moveHistory, &aiFromRow, &aiFromCol, &aiToRow, &aiToCol);
+    int success = getBlackMove(getMoveHistory(), &aiFromRow, &aiFromCol, &aiToRow, &aiToCol);
     
     if (success) {
         // Verify that AI is attempting to move a black piece
-        wchar_t selectedPiece = board[aiFromRow][aiFromCol];
+        wchar_t selectedPiece = getBoardPiece(aiFromRow, aiFromCol);
         
         if (selectedPiece == 0) {
             // AI trying to move from an empty square
@@ -275,13 +276,13 @@ static gboolean process_ai_move(gpointer data) {
                    (int)selectedPiece, aiFromRow, aiFromCol);
             aiRetryCount++;
         }
-        else if (!isValidMove(aiFromRow, aiFromCol, aiToRow, aiToCol)) {
+        else if (!isValidMove(&gamePosition, aiFromRow, aiFromCol, aiToRow, aiToCol)) {
             // AI trying an invalid move
             printf("AI Error: Illegal move from [%d,%d] to [%d,%d]\n", 
                    aiFromRow, aiFromCol, aiToRow, aiToCol);
             aiRetryCount++;
         }
-        else if (moveWouldExposeCheck(aiFromRow, aiFromCol, aiToRow, aiToCol, 0)) {
+        else if (moveWouldExposeCheck(&gamePosition, aiFromRow, aiFromCol, aiToRow, aiToCol, 0)) {
             // AI trying a move that would put its king in check
             printf("AI Error: Move would expose black king to check\n");
             aiRetryCount++;
@@ -291,7 +292,7 @@ static gboolean process_ai_move(gpointer data) {
             printf("AI moving black %lc from [%d,%d] to [%d,%d]\n", 
                    selectedPiece, aiFromRow, aiFromCol, aiToRow, aiToCol);
             aiRetryCount = 0;
-            executeMove(aiFromRow, aiFromCol, aiToRow, aiToCol);
+            executeMove(&gamePosition, aiFromRow, aiFromCol, aiToRow, aiToCol);
             aiThinking = 0;
             refresh_board();
             return FALSE;
@@ -306,7 +307,7 @@ static gboolean process_ai_move(gpointer data) {
             g_free(retryText);
             
             // Schedule another attempt after 10 seconds
-            g_timeout_add_seconds(10, process_ai_move, NULL);
+            UI_TIMEOUT_ADD_SECONDS(10, process_ai_move, NULL);
             return FALSE;  // Remove this timeout
         }
     } else {
@@ -323,7 +324,7 @@ static gboolean process_ai_move(gpointer data) {
         g_free(retryText);
         
         // Schedule another attempt after 10 seconds
-        g_timeout_add_seconds(10, process_ai_move, NULL);
+        UI_TIMEOUT_ADD_SECONDS(10, process_ai_move, NULL);
     } else {
         // All retry attempts exhausted, show error and give up
         GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK,
@@ -343,18 +344,15 @@ static gboolean process_ai_move(gpointer data) {
 
 // Local CPU (minimax) move processing
 static gboolean process_local_cpu_move(gpointer data) {
-    extern void getLocalCPUMove(int *fromRow, int *fromCol, int *toRow, int *toCol);
-    int fromRow, fromCol, toRow, toCol;
-    getLocalCPUMove(&fromRow, &fromCol, &toRow, &toCol);
-    wchar_t selectedPiece = board[fromRow][fromCol];
-    if (selectedPiece == 0 || !isPieceBlack(selectedPiece) || !isValidMove(fromRow, fromCol, toRow, toCol) ||
-        moveWouldExposeCheck(fromRow, fromCol, toRow, toCol, 0)) {
-        // No valid move found (should not happen unless checkmate/stalemate)
+    Move m = getLocalCPUMove(&gamePosition);
+    if (m == MOVE_NONE) {
+        // No valid move found (checkmate or stalemate)
         aiThinking = 0;
         refresh_board();
         return FALSE;
     }
-    executeMove(fromRow, fromCol, toRow, toCol);
+    // The searched move itself, so an underpromotion stays one
+    playMove(&gamePosition, m);
     aiThinking = 0;
     refresh_board();
     return FALSE;
@@ -379,7 +377,7 @@ static void on_button_clicked(GtkWidget *widget, gpointer data) {
 
     // --- First Click: Selecting a piece ---
     if (!selected) {
-        wchar_t piece = board[7 - row][col];
+        wchar_t piece = getBoardPiece(7 - row, col);
         if (piece != 0) {
             if (gameMode == 2) {
                 int isPieceWhite = (piece >= 0x2654 && piece <= 0x2659);
@@ -424,12 +422,12 @@ static void on_button_clicked(GtkWidget *widget, gpointer data) {
             return;
         }
 
-        if (isValidMove(fromRow, fromCol, toRow, toCol)) {
+        if (isValidMove(&gamePosition, fromRow, fromCol, toRow, toCol)) {
             // Check if this move would put the moving player's own king in check
-            wchar_t piece = board[fromRow][fromCol];
+            wchar_t piece = getBoardPiece(fromRow, fromCol);
             int playerIsWhite = isPieceWhite(piece);
             
-            if (moveWouldExposeCheck(fromRow, fromCol, toRow, toCol, playerIsWhite)) {
+            if (moveWouldExposeCheck(&gamePosition, fromRow, fromCol, toRow, toCol, playerIsWhite)) {
                 GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, 
                                                          "Invalid move: would leave your king in check.");
                 gtk_window_set_title(GTK_WINDOW(dialog), "Invalid Move");
@@ -438,7 +436,7 @@ static void on_button_clicked(GtkWidget *widget, gpointer data) {
                 return;
             }
             
-            executeMove(fromRow, fromCol, toRow, toCol);
+            executeMove(&gamePosition, fromRow, fromCol, toRow, toCol);
             
             if (gameMode == 2) {
                 currentPlayer = 1 - currentPlayer;
@@ -448,12 +446,12 @@ static void on_button_clicked(GtkWidget *widget, gpointer data) {
                 aiThinking = 1;
                 aiRetryCount = 0;  // Reset retry counter for new AI turn
                 refresh_board();
-                g_timeout_add(500, process_ai_move, NULL);
+                UI_TIMEOUT_ADD(500, process_ai_move, NULL);
             } else if (gameMode == 3) {
                 // Local CPU mode: call minimax AI for black
                 aiThinking = 1;
                 refresh_board();
-                g_timeout_add(500, process_local_cpu_move, NULL);
+                UI_TIMEOUT_ADD(500, process_local_cpu_move, NULL);
             }
         } else {
             GtkWidget *dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, "Invalid move.");
@@ -466,15 +464,18 @@ static void on_button_clicked(GtkWidget *widget, gpointer data) {
 
 // Modified callback: parses the correct move to rate depending on game mode.
 static void on_rate_move_clicked(GtkWidget *widget, gpointer data) {
-    // Create a local copy to avoid modifying global moveHistory
-    char copyHistory[4096];
-    strcpy(copyHistory, moveHistory);
-    char *token = NULL, *lastToken = NULL, *secondLastToken = NULL;
-    token = strtok(copyHistory, " ");
-    while(token) {
-        secondLastToken = lastToken;
-        lastToken = token;
-        token = strtok(NULL, " ");
+    // The full history goes into the prompt; the moves to rate are rendered on their own
+    const char *moveHistory = getMoveHistory();
+    char lastMove[8], secondLastMove[8];
+    const char *lastToken = NULL, *secondLastToken = NULL;
+    int count = gameRecord.moveCount;
+    if (count >= 1) {
+        formatRecordedMove(&gameRecord, count - 1, lastMove);
+        lastToken = lastMove;
+    }
+    if (count >= 2) {
+        formatRecordedMove(&gameRecord, count - 2, secondLastMove);
+        secondLastToken = secondLastMove;
     }
 
     int modeToRate = gameMode;
@@ -517,6 +518,36 @@ static void on_rate_move_clicked(GtkWidget *widget, gpointer data) {
     }
 }
 
+#ifdef CHESS_COUNTERS
+// Show the search event counters so far and append them to the counters log
+static void on_dump_counters_clicked(GtkWidget *widget, gpointer data) {
+    char json[1024];
+    formatCountersJson(json, sizeof(json), "gui", NULL);
+    dumpCounters("gui", NULL);
+    GtkWidget *msg = gtk_message_dialog_new(GTK_WINDOW(gtk_widget_get_toplevel(widget)),
+                                             GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                             "%s", json);
+    gtk_window_set_title(GTK_WINDOW(msg), "Search Counters");
+    gtk_dialog_run(GTK_DIALOG(msg));
+    gtk_widget_destroy(msg);
+}
+#endif
+
+#ifdef CHESS_UI_LATENCY
+// Shows the main-loop latency so far and appends it to the report file
+static void on_ui_latency_clicked(GtkWidget *widget, gpointer data) {
+    char report[2048];
+    formatUiLatencyReport(report, sizeof(report));
+    UI_LATENCY_DUMP();
+    GtkWidget *msg = gtk_message_dialog_new(GTK_WINDOW(gtk_widget_get_toplevel(widget)),
+                                             GTK_DIALOG_MODAL, GTK_MESSAGE_INFO, GTK_BUTTONS_OK,
+                                             "%s", report);
+    gtk_window_set_title(GTK_WINDOW(msg), "UI Latency");
+    gtk_dialog_run(GTK_DIALOG(msg));
+    gtk_widget_destroy(msg);
+}
+#endif
+
 // New callback for saving the game.
 static void on_save_game_clicked(GtkWidget *widget, gpointer data) {
     GtkWidget *dialog = gtk_file_chooser_dialog_new("Save Game", GTK_WINDOW(gtk_widget_get_toplevel(widget)),
@@ -619,7 +650,7 @@ GtkWidget* create_board_grid() {
             int *data = g_new(int, 2);
             data[0] = row;
             data[1] = col;
-            g_signal_connect_data(button, "clicked", G_CALLBACK(on_button_clicked), data, (GClosureNotify)g_free, 0);
+            UI_CONNECT_CLICKED(button, on_button_clicked, data, (GClosureNotify)g_free);
 
             buttons[row][col] = button;
             gtk_grid_attach(GTK_GRID(grid), button, col + 1, row + 1, 1, 1);
@@ -680,19 +711,33 @@ void startGui(int mode) {
 
     // Add Save Game tool button
     GtkToolItem *saveToolItem = gtk_tool_button_new(NULL, "Save Game");
-    g_signal_connect(saveToolItem, "clicked", G_CALLBACK(on_save_game_clicked), NULL);
+    UI_CONNECT_CLICKED(saveToolItem, on_save_game_clicked, NULL, NULL);
     gtk_toolbar_insert(GTK_TOOLBAR(toolBar), saveToolItem, -1);
 
     // Add Load Game tool button
     GtkToolItem *loadToolItem = gtk_tool_button_new(NULL, "Load Game");
-    g_signal_connect(loadToolItem, "clicked", G_CALLBACK(on_load_game_clicked), NULL);
+    UI_CONNECT_CLICKED(loadToolItem, on_load_game_clicked, NULL, NULL);
     gtk_toolbar_insert(GTK_TOOLBAR(toolBar), loadToolItem, -1);
 
     // Add Rate Last Move tool button
     GtkToolItem *rateToolItem = gtk_tool_button_new(NULL, "Rate Last Move With Gemini");
-    g_signal_connect(rateToolItem, "clicked", G_CALLBACK(on_rate_move_clicked), NULL);
+    UI_CONNECT_CLICKED(rateToolItem, on_rate_move_clicked, NULL, NULL);
     gtk_toolbar_insert(GTK_TOOLBAR(toolBar), rateToolItem, -1);
 
+#ifdef CHESS_COUNTERS
+    // Add Search Counters tool button
+    GtkToolItem *countersToolItem = gtk_tool_button_new(NULL, "Search Counters");
+    UI_CONNECT_CLICKED(countersToolItem, on_dump_counters_clicked, NULL, NULL);
+    gtk_toolbar_insert(GTK_TOOLBAR(toolBar), countersToolItem, -1);
+#endif
+
+#ifdef CHESS_UI_LATENCY
+    // Add UI Latency tool button
+    GtkToolItem *latencyToolItem = gtk_tool_button_new(NULL, "UI Latency");
+    UI_CONNECT_CLICKED(latencyToolItem, on_ui_latency_clicked, NULL, NULL);
+    gtk_toolbar_insert(GTK_TOOLBAR(toolBar), latencyToolItem, -1);
+#endif
+
     // Pack the toolbar into the vbox
     gtk_box_pack_start(GTK_BOX(vbox), toolBar, FALSE, FALSE, 5);
 
@@ -700,6 +745,8 @@ void startGui(int mode) {
     refresh_board();
 
     gtk_widget_show_all(window);
+    UI_LATENCY_START();
     gtk_main();
+    UI_LATENCY_DUMP();
 }
 
@@ -3,12 +3,19 @@
 #include <wchar.h>
 #include <locale.h>
 #include <fcntl.h>
+#ifdef _WIN32
 #include <io.h>
+#else
+// Console text modes exist only on Windows
+#define _setmode(fd, mode) ((void)0)
+#endif
 #include <stdbool.h>
+#include <string.h>
 #include "chess.h"
 #include "saveload.h"
 #include "api.h"
 #include "gui.h"
+#include "transposition.h"
 
 // ...existing declarations and includes...
 
@@ -63,9 +70,10 @@ int main(void) {
     _setmode(_fileno(stdout), _O_U16TEXT);
 #endif
 
-    // Initialize game state and launch the GUI with the selected game mode
+    // Initialize game state and launch the GUI with the selected game mode.
+    // The CPU player's transposition table is allocated here, before any search.
     createBoard();
-    initBitboards();
+    initTranspositionTable();
     startGui(gameMode);
 
     // Removed console-based game loop and board printing.
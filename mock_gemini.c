@@ -0,0 +1,286 @@
+// Local stand-in for the Gemini generateContent endpoint, so the API path in
+// api.c can be exercised and timed without the network. Every POST gets a
+// response shaped like the real one after a configurable delay; a share of
+// requests can be made to fail with an HTTP error or to return a malformed
+// payload. Rating prompts are answered with a score from 1 to 10, anything
+// else with a black move in coordinate notation.
+//
+// Usage: c_chess_mock_gemini [-p port] [-l latency_ms] [-j jitter_ms]
+//                            [-e error_rate] [-m malformed_rate] [-s seed]
+//
+// Point the game or c_chess_api_load at it with
+//   GEMINI_API_URL=http://127.0.0.1:8089/v1beta/models/gemini-2.0-flash:generateContent
+// Ctrl-C prints what was served.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_PORT 8089
+#define MAX_REQUEST_SIZE (1 << 20)
+
+typedef struct {
+    int port;
+    int latencyMs;
+    int jitterMs;
+    double errorRate;
+    double malformedRate;
+    unsigned long long seed;
+} MockConfig;
+
+static MockConfig config = {DEFAULT_PORT, 0, 0, 0.0, 0.0, 1};
+
+static atomic_ullong requestCount;
+static atomic_ullong errorCount;
+static atomic_ullong malformedCount;
+static volatile sig_atomic_t stopRequested;
+
+// Common replies to white's first moves; the game rejects illegal ones and
+// asks again, which is what a real model makes it do too
+static const char *blackMoves[] = {
+    "e7e5", "c7c5", "e7e6", "d7d5", "g8f6", "c7c6", "d7d6", "b8c6", "g7g6", "f7f5",
+};
+
+#define BLACK_MOVE_COUNT ((int)(sizeof(blackMoves) / sizeof(blackMoves[0])))
+
+static const struct {
+    int status;
+    const char *reason;
+    const char *body;
+} errorReplies[] = {
+    {503, "Service Unavailable",
+     "{\"error\": {\"code\": 503, \"message\": \"The model is overloaded. Please try again later.\", \"status\": \"UNAVAILABLE\"}}"},
+    {429, "Too Many Requests",
+     "{\"error\": {\"code\": 429, \"message\": \"Resource has been exhausted (e.g. check quota).\", \"status\": \"RESOURCE_EXHAUSTED\"}}"},
+    {500, "Internal Server Error",
+     "{\"error\": {\"code\": 500, \"message\": \"An internal error has occurred.\", \"status\": \"INTERNAL\"}}"},
+};
+
+#define ERROR_REPLY_COUNT ((int)(sizeof(errorReplies) / sizeof(errorReplies[0])))
+
+// xorshift64*, one stream per request so replies only depend on the seed and
+// the order requests arrive in
+static unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double uniform(unsigned long long *state) {
+    return (double)(nextRandom(state) >> 11) / 9007199254740992.0;
+}
+
+static void sleepMs(int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+static int sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, 0);
+        if (sent <= 0) {
+            return 0;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 1;
+}
+
+static void sendResponse(int fd, int status, const char *reason, const char *body) {
+    char header[256];
+    int length = snprintf(header, sizeof(header),
+                          "HTTP/1.1 %d %s\r\nContent-Type: application/json; charset=UTF-8\r\n"
+                          "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                          status, reason, strlen(body));
+    if (sendAll(fd, header, (size_t)length)) {
+        sendAll(fd, body, strlen(body));
+    }
+}
+
+// Reads one request; returns the body (NUL-terminated, inside buffer) or NULL
+static char *readRequest(int fd, char *buffer, size_t size) {
+    size_t used = 0;
+    char *body = NULL;
+    size_t contentLength = 0;
+
+    while (used < size - 1) {
+        ssize_t got = recv(fd, buffer + used, size - 1 - used, 0);
+        if (got <= 0) {
+            return NULL;
+        }
+        used += (size_t)got;
+        buffer[used] = '\0';
+        if (!body) {
+            char *end = strstr(buffer, "\r\n\r\n");
+            if (!end) {
+                continue;
+            }
+            body = end + 4;
+            for (char *line = strstr(buffer, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+                if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+                    contentLength = strtoul(line + 17, NULL, 10);
+                }
+            }
+        }
+        if ((size_t)(buffer + used - body) >= contentLength) {
+            return body;
+        }
+    }
+    return NULL;
+}
+
+static void *serveConnection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char *buffer = malloc(MAX_REQUEST_SIZE);
+    char *body = buffer ? readRequest(fd, buffer, MAX_REQUEST_SIZE) : NULL;
+
+    if (body) {
+        unsigned long long index = atomic_fetch_add(&requestCount, 1);
+        unsigned long long rng = (config.seed + index) * 0x9E3779B97F4A7C15ULL | 1;
+        double outcome = uniform(&rng);
+        int delay = config.latencyMs;
+        if (config.jitterMs > 0) {
+            delay += (int)(nextRandom(&rng) % (unsigned long long)(2 * config.jitterMs + 1)) - config.jitterMs;
+        }
+        sleepMs(delay > 0 ? delay : 0);
+
+        char text[16];
+        if (strstr(body, "Rate the following")) {
+            snprintf(text, sizeof(text), "%d", 1 + (int)(nextRandom(&rng) % 10));
+        } else {
+            snprintf(text, sizeof(text), "%s", blackMoves[nextRandom(&rng) % BLACK_MOVE_COUNT]);
+        }
+
+        char reply[1024];
+        snprintf(reply, sizeof(reply),
+                 "{\n  \"candidates\": [\n    {\n      \"content\": {\n        \"parts\": [\n"
+                 "          {\n            \"text\": \"%s\\n\"\n          }\n        ],\n"
+                 "        \"role\": \"model\"\n      },\n      \"finishReason\": \"STOP\",\n"
+                 "      \"avgLogprobs\": -0.0123\n    }\n  ],\n"
+                 "  \"usageMetadata\": {\n    \"promptTokenCount\": 212,\n"
+                 "    \"candidatesTokenCount\": 3,\n    \"totalTokenCount\": 215\n  },\n"
+                 "  \"modelVersion\": \"gemini-2.0-flash\"\n}\n",
+                 text);
+
+        if (outcome < config.errorRate) {
+            int which = (int)(nextRandom(&rng) % ERROR_REPLY_COUNT);
+            atomic_fetch_add(&errorCount, 1);
+            sendResponse(fd, errorReplies[which].status, errorReplies[which].reason, errorReplies[which].body);
+        } else if (outcome < config.errorRate + config.malformedRate) {
+            // Cut off before the answer, no candidates, or an answer that is not a move
+            atomic_fetch_add(&malformedCount, 1);
+            switch (nextRandom(&rng) % 3) {
+                case 0:
+                    *strstr(reply, "\"text\"") = '\0';
+                    sendResponse(fd, 200, "OK", reply);
+                    break;
+                case 1:
+                    sendResponse(fd, 200, "OK", "{\n  \"candidates\": [],\n  \"promptFeedback\": {\"blockReason\": \"OTHER\"}\n}\n");
+                    break;
+                default:
+                    sendResponse(fd, 200, "OK",
+                                 "{\"candidates\": [{\"content\": {\"parts\": [{\"text\": \"I would rather not say.\"}], "
+                                 "\"role\": \"model\"}, \"finishReason\": \"STOP\"}]}");
+                    break;
+            }
+        } else {
+            sendResponse(fd, 200, "OK", reply);
+        }
+    } else if (buffer) {
+        sendResponse(fd, 400, "Bad Request", "{\"error\": {\"code\": 400, \"message\": \"Bad request\", \"status\": \"INVALID_ARGUMENT\"}}");
+    }
+
+    free(buffer);
+    close(fd);
+    return NULL;
+}
+
+static void onInterrupt(int signal) {
+    (void)signal;
+    stopRequested = 1;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-p port] [-l latency_ms] [-j jitter_ms] [-e error_rate] "
+                    "[-m malformed_rate] [-s seed]\n", program);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) return usage(argv[0]);
+        if (strcmp(argv[i], "-p") == 0) config.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0) config.latencyMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-j") == 0) config.jitterMs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-e") == 0) config.errorRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-m") == 0) config.malformedRate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0) config.seed = strtoull(argv[++i], NULL, 10);
+        else return usage(argv[0]);
+    }
+    if (config.port <= 0 || config.port > 65535 || config.latencyMs < 0 || config.jitterMs < 0 ||
+        config.errorRate < 0 || config.malformedRate < 0 || config.errorRate + config.malformedRate > 1) {
+        return usage(argv[0]);
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)config.port);
+    if (listener < 0 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 512) < 0) {
+        fprintf(stderr, "Error: Could not listen on 127.0.0.1:%d: %s\n", config.port, strerror(errno));
+        return 1;
+    }
+
+    // No SA_RESTART, so Ctrl-C interrupts accept()
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    // A client that gives up mid-reply must not take the server down
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Serving generateContent on http://127.0.0.1:%d/v1beta/models/gemini-2.0-flash:generateContent\n",
+           config.port);
+    printf("Latency %d ms +/- %d ms, errors %.1f%%, malformed %.1f%%\n", config.latencyMs, config.jitterMs,
+           config.errorRate * 100, config.malformedRate * 100);
+    fflush(stdout);
+
+    while (!stopRequested) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serveConnection, (void *)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    close(listener);
+    printf("\nServed %llu requests: %llu errors, %llu malformed\n", (unsigned long long)atomic_load(&requestCount),
+           (unsigned long long)atomic_load(&errorCount), (unsigned long long)atomic_load(&malformedCount));
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "movegen.h"
+#include "bitboard.h"
+#include "geometry_tables.h"
+#include "counters.h"
+
+#define FILE_A 0x0101010101010101ULL
+#define FILE_H 0x8080808080808080ULL
+#define RANK_1 0x00000000000000FFULL
+#define RANK_3 0x0000000000FF0000ULL
+#define RANK_6 0x0000FF0000000000ULL
+#define RANK_8 0xFF00000000000000ULL
+
+static inline void addMove(MoveList *list, int from, int to, int kind) {
+    list->moves[list->count++] = ENCODE_MOVE(from, to, kind);
+}
+
+// Serialise pawn destinations that were produced by shifting the pawn set by
+// delta (positive = towards rank 8); arrivals on the last rank expand into all four promotions.
+static void addPawnMoves(MoveList *list, Bitboard targets, int delta, int kind,
+                         Bitboard promotionRank) {
+    while (targets) {
+        int to = popLsb(&targets);
+        int from = to - delta;
+        if ((promotionRank >> to) & 1) {
+            // Queen first, then rook, bishop and knight
+            for (int piece = 3; piece >= 0; --piece) {
+                addMove(list, from, to, kind | MOVE_PROMOTION | piece);
+            }
+        } else {
+            addMove(list, from, to, kind);
+        }
+    }
+}
+
+static void addPieceMoves(MoveList *list, int from, Bitboard targets, Bitboard enemy) {
+    while (targets) {
+        int to = popLsb(&targets);
+        addMove(list, from, to, ((enemy >> to) & 1) ? MOVE_CAPTURE : MOVE_QUIET);
+    }
+}
+
+#define SIDE_IS_WHITE 1
+#define SIDE_FN(name) name##White
+#include "movegen_side.h"
+#undef SIDE_IS_WHITE
+#undef SIDE_FN
+
+#define SIDE_IS_WHITE 0
+#define SIDE_FN(name) name##Black
+#include "movegen_side.h"
+#undef SIDE_IS_WHITE
+#undef SIDE_FN
+
+// The public entry points pick the instance for the side once per call
+
+void generatePseudoLegalMoves(const Position *pos, int playerIsWhite, MoveList *list) {
+    if (playerIsWhite) {
+        generatePseudoLegalMovesWhite(pos, list);
+    } else {
+        generatePseudoLegalMovesBlack(pos, list);
+    }
+}
+
+void computeCheckInfo(const Position *pos, int playerIsWhite, CheckInfo *info) {
+    if (playerIsWhite) {
+        computeCheckInfoWhite(pos, info);
+    } else {
+        computeCheckInfoBlack(pos, info);
+    }
+}
+
+void generateLegalMovesBitboard(const Position *pos, int playerIsWhite, MoveList *list) {
+    if (playerIsWhite) {
+        generateLegalMovesWhite(pos, list);
+    } else {
+        generateLegalMovesBlack(pos, list);
+    }
+}
+
+#ifdef CHESS_MOVEGEN_MAILBOX
+void generateLegalMoves(const Position *pos, int playerIsWhite, MoveList *list) {
+    COUNT_EVENT(COUNTER_LEGAL_MOVEGEN);
+    generateLegalMovesMailbox(pos, playerIsWhite, list);
+}
+
+int hasLegalMoves(const Position *pos, int playerIsWhite) {
+    MoveList list;
+    generateLegalMovesMailbox(pos, playerIsWhite, &list);
+    return list.count > 0;
+}
+#else
+void generateLegalMoves(const Position *pos, int playerIsWhite, MoveList *list) {
+    COUNT_EVENT(COUNTER_LEGAL_MOVEGEN);
+    generateLegalMovesBitboard(pos, playerIsWhite, list);
+}
+
+int hasLegalMoves(const Position *pos, int playerIsWhite) {
+    return playerIsWhite ? hasLegalMovesWhite(pos) : hasLegalMovesBlack(pos);
+}
+#endif
+
+// Attack check using bitboards: leapers by table, sliders by magic lookup.
+// defenderIsWhite indicates the color of the king that would occupy the square.
+int isSquareAttackedBB(const Position *pos, int row, int col, int defenderIsWhite) {
+    int sq = SQUARE(row, col);
+    Bitboard occupied = pos->occupancy[OCC_ALL];
+    return (defenderIsWhite ? enemyAttackersWhite(pos, sq, occupied)
+                            : enemyAttackersBlack(pos, sq, occupied)) != 0;
+}
@@ -0,0 +1,61 @@
+#ifndef C_CHESS_MOVEGEN_H
+#define C_CHESS_MOVEGEN_H
+
+#include "chess.h"
+
+// No legal chess position has more than 218 moves; round up for headroom
+#define MAX_MOVES 256
+
+// Generated moves with a parallel array of ordering scores, so the moves
+// themselves stay 16 bits
+typedef struct {
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count;
+} MoveList;
+
+// Append every pseudo-legal move for the given side: captures, quiet moves,
+// promotions (queen, rook, bishop, knight), en passant and castling. Moves may
+// still leave the mover's own king in check; castling already checks that the
+// king does not start on, pass or land on an attacked square.
+void generatePseudoLegalMoves(const Position *pos, int playerIsWhite, MoveList *list);
+
+// Pieces giving check to the side's king and that side's absolutely pinned
+// pieces, computed once per node
+typedef struct {
+    Bitboard checkers;
+    Bitboard pinned;
+    int king;           // square of the king
+} CheckInfo;
+
+void computeCheckInfo(const Position *pos, int playerIsWhite, CheckInfo *info);
+
+// Fill list with exactly the legal moves, using the backend chosen at build
+// time (CHESS_MOVEGEN_BACKEND). hasLegalMoves in chess.h follows the same choice.
+void generateLegalMoves(const Position *pos, int playerIsWhite, MoveList *list);
+
+// Move generation backends; both are always built so they can be compared.
+// Bitboard (movegen.c): check evasions and pinned pieces are handled with
+// target masks, so no move is ever made to test it.
+// Mailbox (movegen_mailbox.c): pieces walk their steps and rays over the
+// square array and every move is tested on a private copy of the board, with
+// no bitboard attack code at all. Slow, but an independent reference.
+void generateLegalMovesBitboard(const Position *pos, int playerIsWhite, MoveList *list);
+void generateLegalMovesMailbox(const Position *pos, int playerIsWhite, MoveList *list);
+
+// Everything makeMove overwrites that cannot be recomputed from the move itself
+typedef struct {
+    uint64_t key;
+    uint16_t fiftyMoveCounter;
+    uint8_t captured;       // piece code taken, or NO_PIECE
+    uint8_t castlingRights;
+    int8_t enPassantSquare;
+} Undo;
+
+// Make/unmake (defined in moves.c). Both are O(1): the board, bitboards and
+// key are updated incrementally and restored from the undo record.
+Move moveFromSquares(const Position *pos, int from, int to);
+void makeMove(Position *pos, Move m, Undo *undo);
+void unmakeMove(Position *pos, Move m, const Undo *undo);
+
+#endif //C_CHESS_MOVEGEN_H
@@ -0,0 +1,172 @@
+// A/B harness for the move generation backends: plays random games, runs the
+// bitboard and mailbox generators on every position reached, checks that they
+// produce the same set of legal moves and reports their relative speed.
+//
+// Usage: c_chess_movegen_ab [positions] [seed]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chess.h"
+#include "movegen.h"
+
+#define DEFAULT_POSITIONS 1000000
+#define BATCH_SIZE 4096
+#define MAX_GAME_PLIES 300
+#define MAX_REPORTED_MISMATCHES 10
+
+// Games start from these in turn, so castling, en passant and promotions
+// come up often
+static const char *startFens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+#define START_COUNT ((int)(sizeof(startFens) / sizeof(startFens[0])))
+
+static Position batch[BATCH_SIZE];
+static MoveList bitboardMoves[BATCH_SIZE];
+static MoveList mailboxMoves[BATCH_SIZE];
+
+// xorshift64*, fixed seed so a failing run can be repeated
+static unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compareMoves(const void *a, const void *b) {
+    return (int)*(const Move *)a - (int)*(const Move *)b;
+}
+
+static void sortList(MoveList *list) {
+    qsort(list->moves, (size_t)list->count, sizeof(Move), compareMoves);
+}
+
+static void writeFen(const Position *pos, char *out) {
+    static const char pieceLetters[] = " KQRBNPkqrbnp";
+    for (int row = 7; row >= 0; --row) {
+        int empty = 0;
+        for (int col = 0; col < 8; ++col) {
+            int piece = pos->squares[SQUARE(row, col)];
+            if (piece == NO_PIECE) {
+                empty++;
+                continue;
+            }
+            if (empty) *out++ = (char)('0' + empty);
+            empty = 0;
+            *out++ = pieceLetters[piece];
+        }
+        if (empty) *out++ = (char)('0' + empty);
+        if (row) *out++ = '/';
+    }
+    out += sprintf(out, " %c ", pos->sideToMove ? 'w' : 'b');
+    if (!pos->castlingRights) *out++ = '-';
+    if (pos->castlingRights & CASTLE_WHITE_KINGSIDE) *out++ = 'K';
+    if (pos->castlingRights & CASTLE_WHITE_QUEENSIDE) *out++ = 'Q';
+    if (pos->castlingRights & CASTLE_BLACK_KINGSIDE) *out++ = 'k';
+    if (pos->castlingRights & CASTLE_BLACK_QUEENSIDE) *out++ = 'q';
+    if (pos->enPassantSquare >= 0) {
+        sprintf(out, " %c%d %d 1", 'a' + SQUARE_COL(pos->enPassantSquare),
+                SQUARE_ROW(pos->enPassantSquare) + 1, pos->fiftyMoveCounter);
+    } else {
+        sprintf(out, " - %d 1", pos->fiftyMoveCounter);
+    }
+}
+
+static void printMoves(const char *label, const MoveList *list) {
+    printf("  %-9s %3d:", label, list->count);
+    for (int i = 0; i < list->count; ++i) {
+        Move m = list->moves[i];
+        printf(" %c%d%c%d/%d", 'a' + SQUARE_COL(MOVE_FROM(m)), SQUARE_ROW(MOVE_FROM(m)) + 1,
+               'a' + SQUARE_COL(MOVE_TO(m)), SQUARE_ROW(MOVE_TO(m)) + 1, MOVE_KIND(m));
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    long long target = argc > 1 ? atoll(argv[1]) : DEFAULT_POSITIONS;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    unsigned long long rng = seed ? seed : 1;
+    long long tested = 0, totalMoves = 0;
+    int mismatches = 0, games = 0, ply = 0;
+    double bitboardSeconds = 0, mailboxSeconds = 0;
+    Position game;
+
+    if (target <= 0) {
+        fprintf(stderr, "Usage: %s [positions] [seed]\n", argv[0]);
+        return 1;
+    }
+    setPositionFromFen(&game, startFens[0]);
+
+    while (tested < target) {
+        // Collect a batch of playout positions
+        int count = 0;
+        while (count < BATCH_SIZE && tested + count < target) {
+            MoveList list;
+            generateLegalMovesBitboard(&game, game.sideToMove, &list);
+            if (list.count == 0 || ply >= MAX_GAME_PLIES || isFiftyMoveRuleDraw(&game)) {
+                setPositionFromFen(&game, startFens[++games % START_COUNT]);
+                ply = 0;
+                continue;
+            }
+            batch[count++] = game;
+            Undo undo;
+            makeMove(&game, list.moves[nextRandom(&rng) % (unsigned long long)list.count], &undo);
+            ply++;
+        }
+
+        double start = now();
+        for (int i = 0; i < count; ++i) {
+            generateLegalMovesBitboard(&batch[i], batch[i].sideToMove, &bitboardMoves[i]);
+        }
+        bitboardSeconds += now() - start;
+
+        start = now();
+        for (int i = 0; i < count; ++i) {
+            generateLegalMovesMailbox(&batch[i], batch[i].sideToMove, &mailboxMoves[i]);
+        }
+        mailboxSeconds += now() - start;
+
+        for (int i = 0; i < count; ++i) {
+            sortList(&bitboardMoves[i]);
+            sortList(&mailboxMoves[i]);
+            totalMoves += bitboardMoves[i].count;
+            if (bitboardMoves[i].count == mailboxMoves[i].count &&
+                memcmp(bitboardMoves[i].moves, mailboxMoves[i].moves,
+                       (size_t)bitboardMoves[i].count * sizeof(Move)) == 0) {
+                continue;
+            }
+            if (++mismatches <= MAX_REPORTED_MISMATCHES) {
+                char fen[100];
+                writeFen(&batch[i], fen);
+                printf("Mismatch: %s\n", fen);
+                printMoves("bitboard", &bitboardMoves[i]);
+                printMoves("mailbox", &mailboxMoves[i]);
+            }
+        }
+        tested += count;
+    }
+
+    printf("Positions: %lld from %d games, %lld legal moves\n", tested, games + 1, totalMoves);
+    printf("Bitboard:  %.3f s, %.0f positions/sec\n", bitboardSeconds, tested / bitboardSeconds);
+    printf("Mailbox:   %.3f s, %.0f positions/sec\n", mailboxSeconds, tested / mailboxSeconds);
+    printf("Bitboard is %.1fx the speed of mailbox\n", mailboxSeconds / bitboardSeconds);
+    if (mismatches) {
+        printf("%d positions differ\n", mismatches);
+        return 1;
+    }
+    printf("Move sets identical\n");
+    return 0;
+}
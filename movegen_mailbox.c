@@ -0,0 +1,208 @@
+#include <string.h>
+#include "movegen.h"
+
+// Reference generator that shares no attack code with the bitboard backend:
+// every piece walks its steps and rays over the square array, each candidate
+// is played on a private copy of the board, and it is kept if no enemy piece
+// then reaches the king by the same walks. A bug in the magic tables, the pin
+// masks or the incremental makeMove cannot hide in both backends at once.
+
+static const int KNIGHT_STEPS[8][2] = {{2, 1}, {1, 2}, {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}, {1, -2}, {2, -1}};
+static const int ROOK_STEPS[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+static const int BISHOP_STEPS[4][2] = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+
+static int onBoard(int row, int col) {
+    return row >= 0 && row < 8 && col >= 0 && col < 8;
+}
+
+static int isOwnPiece(int piece, int playerIsWhite) {
+    return playerIsWhite ? PIECE_IS_WHITE(piece) : PIECE_IS_BLACK(piece);
+}
+
+// First piece met walking from (row, col) in one direction, or NO_PIECE at the edge
+static int firstPieceOnRay(const uint8_t *board, int row, int col, int rowStep, int colStep) {
+    for (row += rowStep, col += colStep; onBoard(row, col); row += rowStep, col += colStep) {
+        if (board[SQUARE(row, col)] != NO_PIECE) return board[SQUARE(row, col)];
+    }
+    return NO_PIECE;
+}
+
+// Check if any piece of the side other than defenderIsWhite attacks the square
+static int isSquareAttackedMailbox(const uint8_t *board, int row, int col, int defenderIsWhite) {
+    int offset = defenderIsWhite ? B_KING - W_KING : 0;   // attacker's code minus white's
+
+    // Pawns attack from one row nearer their own side
+    int pawnRow = row + (defenderIsWhite ? 1 : -1);
+    for (int colStep = -1; colStep <= 1; colStep += 2) {
+        if (onBoard(pawnRow, col + colStep) && board[SQUARE(pawnRow, col + colStep)] == W_PAWN + offset) return 1;
+    }
+    for (int i = 0; i < 8; ++i) {
+        int r = row + KNIGHT_STEPS[i][0], c = col + KNIGHT_STEPS[i][1];
+        if (onBoard(r, c) && board[SQUARE(r, c)] == W_KNIGHT + offset) return 1;
+    }
+    for (int r = row - 1; r <= row + 1; ++r) {
+        for (int c = col - 1; c <= col + 1; ++c) {
+            if (onBoard(r, c) && board[SQUARE(r, c)] == W_KING + offset) return 1;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        int piece = firstPieceOnRay(board, row, col, ROOK_STEPS[i][0], ROOK_STEPS[i][1]);
+        if (piece == W_ROOK + offset || piece == W_QUEEN + offset) return 1;
+        piece = firstPieceOnRay(board, row, col, BISHOP_STEPS[i][0], BISHOP_STEPS[i][1]);
+        if (piece == W_BISHOP + offset || piece == W_QUEEN + offset) return 1;
+    }
+    return 0;
+}
+
+// Destinations of the piece on from, ignoring checks to its own king
+static Bitboard pieceTargets(const Position *pos, int from, int playerIsWhite) {
+    const uint8_t *board = pos->squares;
+    int piece = board[from];
+    int type = playerIsWhite ? piece : piece - (B_KING - W_KING);
+    int row = SQUARE_ROW(from), col = SQUARE_COL(from);
+    Bitboard targets = 0;
+
+    if (type == W_PAWN) {
+        int direction = playerIsWhite ? 1 : -1;
+        int startRow = playerIsWhite ? 1 : 6;
+        int nextRow = row + direction;
+        if (!onBoard(nextRow, col)) return 0;
+        if (board[SQUARE(nextRow, col)] == NO_PIECE) {
+            targets |= 1ULL << SQUARE(nextRow, col);
+            if (row == startRow && board[SQUARE(nextRow + direction, col)] == NO_PIECE) {
+                targets |= 1ULL << SQUARE(nextRow + direction, col);
+            }
+        }
+        for (int colStep = -1; colStep <= 1; colStep += 2) {
+            if (!onBoard(nextRow, col + colStep)) continue;
+            int to = SQUARE(nextRow, col + colStep);
+            if ((board[to] != NO_PIECE && !isOwnPiece(board[to], playerIsWhite)) ||
+                (board[to] == NO_PIECE && to == pos->enPassantSquare)) {
+                targets |= 1ULL << to;
+            }
+        }
+    } else if (type == W_KNIGHT) {
+        for (int i = 0; i < 8; ++i) {
+            int r = row + KNIGHT_STEPS[i][0], c = col + KNIGHT_STEPS[i][1];
+            if (onBoard(r, c) && !isOwnPiece(board[SQUARE(r, c)], playerIsWhite)) targets |= 1ULL << SQUARE(r, c);
+        }
+    } else if (type == W_KING) {
+        for (int r = row - 1; r <= row + 1; ++r) {
+            for (int c = col - 1; c <= col + 1; ++c) {
+                if (onBoard(r, c) && !isOwnPiece(board[SQUARE(r, c)], playerIsWhite)) targets |= 1ULL << SQUARE(r, c);
+            }
+        }
+
+        // Castling: the right, an empty path, the rook in its corner, and a
+        // king that does not start on, cross or land on an attacked square
+        int homeRow = playerIsWhite ? 0 : 7;
+        int rook = playerIsWhite ? W_ROOK : B_ROOK;
+        int kingside = playerIsWhite ? CASTLE_WHITE_KINGSIDE : CASTLE_BLACK_KINGSIDE;
+        int queenside = playerIsWhite ? CASTLE_WHITE_QUEENSIDE : CASTLE_BLACK_QUEENSIDE;
+        if (from == SQUARE(homeRow, 4) && !isSquareAttackedMailbox(board, homeRow, 4, playerIsWhite)) {
+            if ((pos->castlingRights & kingside) && board[SQUARE(homeRow, 7)] == rook &&
+                board[SQUARE(homeRow, 5)] == NO_PIECE && board[SQUARE(homeRow, 6)] == NO_PIECE &&
+                !isSquareAttackedMailbox(board, homeRow, 5, playerIsWhite) &&
+                !isSquareAttackedMailbox(board, homeRow, 6, playerIsWhite)) {
+                targets |= 1ULL << SQUARE(homeRow, 6);
+            }
+            if ((pos->castlingRights & queenside) && board[SQUARE(homeRow, 0)] == rook &&
+                board[SQUARE(homeRow, 1)] == NO_PIECE && board[SQUARE(homeRow, 2)] == NO_PIECE &&
+                board[SQUARE(homeRow, 3)] == NO_PIECE &&
+                !isSquareAttackedMailbox(board, homeRow, 3, playerIsWhite) &&
+                !isSquareAttackedMailbox(board, homeRow, 2, playerIsWhite)) {
+                targets |= 1ULL << SQUARE(homeRow, 2);
+            }
+        }
+    } else {
+        // Sliders walk each of their rays up to and including the first piece
+        for (int i = 0; i < 8; ++i) {
+            const int *step = i < 4 ? ROOK_STEPS[i] : BISHOP_STEPS[i - 4];
+            if ((i < 4 && type == W_BISHOP) || (i >= 4 && type == W_ROOK)) continue;
+            for (int r = row + step[0], c = col + step[1]; onBoard(r, c); r += step[0], c += step[1]) {
+                if (isOwnPiece(board[SQUARE(r, c)], playerIsWhite)) break;
+                targets |= 1ULL << SQUARE(r, c);
+                if (board[SQUARE(r, c)] != NO_PIECE) break;
+            }
+        }
+    }
+    return targets;
+}
+
+// Play a move on the bare square array, taking the en passant pawn or moving
+// the castling rook. Returns the captured piece for unmakeMailbox.
+static int makeMailbox(uint8_t *board, Move m) {
+    int from = MOVE_FROM(m), to = MOVE_TO(m), kind = MOVE_KIND(m);
+    int captured = board[to];
+    board[to] = board[from];
+    board[from] = NO_PIECE;
+    if (kind == MOVE_EN_PASSANT) {
+        int pawnSquare = SQUARE(SQUARE_ROW(from), SQUARE_COL(to));
+        captured = board[pawnSquare];
+        board[pawnSquare] = NO_PIECE;
+    } else if (kind == MOVE_KING_CASTLE) {
+        board[from + 1] = board[from + 3];
+        board[from + 3] = NO_PIECE;
+    } else if (kind == MOVE_QUEEN_CASTLE) {
+        board[from - 1] = board[from - 4];
+        board[from - 4] = NO_PIECE;
+    }
+    return captured;
+}
+
+static void unmakeMailbox(uint8_t *board, Move m, int captured) {
+    int from = MOVE_FROM(m), to = MOVE_TO(m), kind = MOVE_KIND(m);
+    board[from] = board[to];
+    board[to] = NO_PIECE;
+    if (kind == MOVE_EN_PASSANT) {
+        board[SQUARE(SQUARE_ROW(from), SQUARE_COL(to))] = (uint8_t)captured;
+    } else {
+        board[to] = (uint8_t)captured;
+        if (kind == MOVE_KING_CASTLE) {
+            board[from + 3] = board[from + 1];
+            board[from + 1] = NO_PIECE;
+        } else if (kind == MOVE_QUEEN_CASTLE) {
+            board[from - 4] = board[from - 1];
+            board[from - 1] = NO_PIECE;
+        }
+    }
+}
+
+// Try every destination of every piece of the side, in square order, and
+// expand queen promotions into all four pieces
+void generateLegalMovesMailbox(const Position *pos, int playerIsWhite, MoveList *list) {
+    uint8_t board[64];
+    memcpy(board, pos->squares, sizeof(board));
+    int king = -1;
+    for (int sq = 0; sq < 64; ++sq) {
+        if (board[sq] == (playerIsWhite ? W_KING : B_KING)) king = sq;
+    }
+
+    list->count = 0;
+    for (int from = 0; from < 64; ++from) {
+        if (!isOwnPiece(board[from], playerIsWhite)) continue;
+        Bitboard targets = pieceTargets(pos, from, playerIsWhite);
+
+        for (int to = 0; to < 64; ++to) {
+            if (!((targets >> to) & 1)) continue;
+            Move m = moveFromSquares(pos, from, to);
+
+            // A side without a king is never in check, as in isKingInCheck
+            int kingAfter = from == king ? to : king;
+            int captured = makeMailbox(board, m);
+            int exposed = kingAfter >= 0 &&
+                          isSquareAttackedMailbox(board, SQUARE_ROW(kingAfter), SQUARE_COL(kingAfter), playerIsWhite);
+            unmakeMailbox(board, m, captured);
+            if (exposed) continue;
+
+            if (MOVE_IS_PROMOTION(m)) {
+                // Queen first, then rook, bishop and knight, as the bitboard backend
+                for (int promotion = 3; promotion >= 0; --promotion) {
+                    list->moves[list->count++] = ENCODE_MOVE(from, to, (MOVE_KIND(m) & ~3) | promotion);
+                }
+            } else {
+                list->moves[list->count++] = m;
+            }
+        }
+    }
+}
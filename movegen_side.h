@@ -0,0 +1,317 @@
+// Colour-specialised move generation, included twice by movegen.c: once with
+// SIDE_IS_WHITE 1 and SIDE_FN(name) name##White, once with both set for black.
+// Every colour-dependent quantity below is a compile-time constant, so neither
+// instance branches on the side to move. No include guard on purpose.
+
+#if SIDE_IS_WHITE
+#define US                OCC_WHITE
+#define THEM              OCC_BLACK
+#define OUR_PIECES        0              // bitboard index of our king
+#define THEIR_PIECES      6
+#define PUSH(bb)          ((bb) << 8)
+#define CAPTURE_WEST(bb)  (((bb) & ~FILE_A) << 7)
+#define CAPTURE_EAST(bb)  (((bb) & ~FILE_H) << 9)
+#define UP                8
+#define WEST              7
+#define EAST              9
+#define DOUBLE_PUSH_RANK  RANK_3         // single pushes that may push again
+#define PROMOTION_RANK    RANK_8
+#define BACK_ROW          0
+#define OUR_ROOK          W_ROOK
+#define OUR_KING          W_KING
+#define KINGSIDE_RIGHT    CASTLE_WHITE_KINGSIDE
+#define QUEENSIDE_RIGHT   CASTLE_WHITE_QUEENSIDE
+#else
+#define US                OCC_BLACK
+#define THEM              OCC_WHITE
+#define OUR_PIECES        6
+#define THEIR_PIECES      0
+#define PUSH(bb)          ((bb) >> 8)
+#define CAPTURE_WEST(bb)  (((bb) & ~FILE_A) >> 9)
+#define CAPTURE_EAST(bb)  (((bb) & ~FILE_H) >> 7)
+#define UP                (-8)
+#define WEST              (-9)
+#define EAST              (-7)
+#define DOUBLE_PUSH_RANK  RANK_6
+#define PROMOTION_RANK    RANK_1
+#define BACK_ROW          7
+#define OUR_ROOK          B_ROOK
+#define OUR_KING          B_KING
+#define KINGSIDE_RIGHT    CASTLE_BLACK_KINGSIDE
+#define QUEENSIDE_RIGHT   CASTLE_BLACK_QUEENSIDE
+#endif
+
+#define KING_HOME SQUARE(BACK_ROW, 4)
+
+// Enemy pieces attacking sq, looking through the given occupancy
+static inline Bitboard SIDE_FN(enemyAttackers)(const Position *pos, int sq, Bitboard occupied) {
+    const Bitboard *their = pos->bitboards + THEIR_PIECES;
+    // An enemy pawn attacks sq exactly when our pawn on sq would attack it
+    return (PAWN_ATTACKS[US][sq] & their[W_PAWN - 1]) |
+           (KNIGHT_ATTACKS[sq] & their[W_KNIGHT - 1]) |
+           (KING_ATTACKS[sq] & their[W_KING - 1]) |
+           (bishopAttacks(sq, occupied) & (their[W_BISHOP - 1] | their[W_QUEEN - 1])) |
+           (rookAttacks(sq, occupied) & (their[W_ROOK - 1] | their[W_QUEEN - 1]));
+}
+
+// Pawn pushes and captures (not en passant) for the given pawns, keeping only
+// destinations inside targets
+static void SIDE_FN(generatePawnMoves)(const Position *pos, Bitboard pawns, Bitboard targets,
+                                       MoveList *list) {
+    Bitboard enemy = pos->occupancy[THEM] & targets;
+    Bitboard empty = ~pos->occupancy[OCC_ALL];
+
+    Bitboard single = PUSH(pawns) & empty;
+    Bitboard doubled = PUSH(single & DOUBLE_PUSH_RANK) & empty;
+    addPawnMoves(list, single & targets, UP, MOVE_QUIET, PROMOTION_RANK);
+    addPawnMoves(list, doubled & targets, 2 * UP, MOVE_DOUBLE_PUSH, PROMOTION_RANK);
+    addPawnMoves(list, CAPTURE_WEST(pawns) & enemy, WEST, MOVE_CAPTURE, PROMOTION_RANK);
+    addPawnMoves(list, CAPTURE_EAST(pawns) & enemy, EAST, MOVE_CAPTURE, PROMOTION_RANK);
+}
+
+// Knight, bishop, rook and queen moves into targets. A pinned piece may only
+// move along the line through its king.
+static void SIDE_FN(generatePieceMoves)(const Position *pos, Bitboard targets, Bitboard pinned,
+                                        int king, MoveList *list) {
+    const Bitboard *our = pos->bitboards + OUR_PIECES;
+    Bitboard enemy = pos->occupancy[THEM];
+    Bitboard occupied = pos->occupancy[OCC_ALL];
+    Bitboard pieces;
+
+    pieces = our[W_KNIGHT - 1] & ~pinned;  // a pinned knight can never move
+    while (pieces) {
+        int from = popLsb(&pieces);
+        addPieceMoves(list, from, KNIGHT_ATTACKS[from] & targets, enemy);
+    }
+    pieces = our[W_BISHOP - 1] | our[W_QUEEN - 1];
+    while (pieces) {
+        int from = popLsb(&pieces);
+        Bitboard allowed = ((pinned >> from) & 1) ? targets & LINE[king][from] : targets;
+        addPieceMoves(list, from, bishopAttacks(from, occupied) & allowed, enemy);
+    }
+    pieces = our[W_ROOK - 1] | our[W_QUEEN - 1];
+    while (pieces) {
+        int from = popLsb(&pieces);
+        Bitboard allowed = ((pinned >> from) & 1) ? targets & LINE[king][from] : targets;
+        addPieceMoves(list, from, rookAttacks(from, occupied) & allowed, enemy);
+    }
+}
+
+// Castling out of, through or into check is refused here
+static void SIDE_FN(generateCastling)(const Position *pos, MoveList *list) {
+    Bitboard occupied = pos->occupancy[OCC_ALL];
+
+    if (!(pos->castlingRights & (KINGSIDE_RIGHT | QUEENSIDE_RIGHT))) return;
+    if (pos->squares[KING_HOME] != OUR_KING) return;
+    if (SIDE_FN(enemyAttackers)(pos, KING_HOME, occupied)) return;
+
+    if ((pos->castlingRights & KINGSIDE_RIGHT) && pos->squares[KING_HOME + 3] == OUR_ROOK &&
+        !(occupied & BETWEEN[KING_HOME][KING_HOME + 3]) &&
+        !SIDE_FN(enemyAttackers)(pos, KING_HOME + 1, occupied) &&
+        !SIDE_FN(enemyAttackers)(pos, KING_HOME + 2, occupied)) {
+        addMove(list, KING_HOME, KING_HOME + 2, MOVE_KING_CASTLE);
+    }
+    if ((pos->castlingRights & QUEENSIDE_RIGHT) && pos->squares[KING_HOME - 4] == OUR_ROOK &&
+        !(occupied & BETWEEN[KING_HOME][KING_HOME - 4]) &&
+        !SIDE_FN(enemyAttackers)(pos, KING_HOME - 1, occupied) &&
+        !SIDE_FN(enemyAttackers)(pos, KING_HOME - 2, occupied)) {
+        addMove(list, KING_HOME, KING_HOME - 2, MOVE_QUEEN_CASTLE);
+    }
+}
+
+static void SIDE_FN(generatePseudoLegalMoves)(const Position *pos, MoveList *list) {
+    const Bitboard *our = pos->bitboards + OUR_PIECES;
+    Bitboard own = pos->occupancy[US];
+
+    SIDE_FN(generatePawnMoves)(pos, our[W_PAWN - 1], ~own, list);
+    if (pos->enPassantSquare >= 0) {
+        int ep = pos->enPassantSquare;
+        Bitboard attackers = PAWN_ATTACKS[THEM][ep] & our[W_PAWN - 1];
+        while (attackers) {
+            addMove(list, popLsb(&attackers), ep, MOVE_EN_PASSANT);
+        }
+    }
+    SIDE_FN(generatePieceMoves)(pos, ~own, 0, 0, list);
+    Bitboard kings = our[W_KING - 1];
+    while (kings) {
+        int from = popLsb(&kings);
+        addPieceMoves(list, from, KING_ATTACKS[from] & ~own, pos->occupancy[THEM]);
+    }
+    SIDE_FN(generateCastling)(pos, list);
+}
+
+static void SIDE_FN(computeCheckInfo)(const Position *pos, CheckInfo *info) {
+    const Bitboard *their = pos->bitboards + THEIR_PIECES;
+    Bitboard occupied = pos->occupancy[OCC_ALL];
+    int king = lsb(pos->bitboards[OUR_PIECES + W_KING - 1]);
+
+    info->king = king;
+    info->checkers = SIDE_FN(enemyAttackers)(pos, king, occupied);
+    info->pinned = 0;
+
+    // Enemy sliders aimed at the king through exactly one of our pieces pin it
+    Bitboard snipers = (rookAttacks(king, 0) & (their[W_ROOK - 1] | their[W_QUEEN - 1])) |
+                       (bishopAttacks(king, 0) & (their[W_BISHOP - 1] | their[W_QUEEN - 1]));
+    while (snipers) {
+        Bitboard blockers = BETWEEN[king][popLsb(&snipers)] & occupied;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & pos->occupancy[US])) {
+            info->pinned |= blockers;
+        }
+    }
+}
+
+// En passant removes two pieces from one rank, so it is verified directly
+// against slider attacks on the king rather than by pin masks.
+static int SIDE_FN(isEnPassantLegal)(const Position *pos, int from, int king) {
+    int ep = pos->enPassantSquare;
+    int captured = ep - UP;
+    Bitboard occupied = (pos->occupancy[OCC_ALL] ^ (1ULL << from) ^ (1ULL << captured)) | (1ULL << ep);
+    return !(SIDE_FN(enemyAttackers)(pos, king, occupied) & ~(1ULL << captured));
+}
+
+static void SIDE_FN(generateLegalMoves)(const Position *pos, MoveList *list) {
+    const Bitboard *our = pos->bitboards + OUR_PIECES;
+    Bitboard own = pos->occupancy[US];
+    Bitboard enemy = pos->occupancy[THEM];
+    CheckInfo info;
+
+    list->count = 0;
+    if (!our[W_KING - 1]) {
+        SIDE_FN(generatePseudoLegalMoves)(pos, list);
+        return;
+    }
+    SIDE_FN(computeCheckInfo)(pos, &info);
+    int king = info.king;
+
+    // King steps: the destination must be safe with the king lifted off its
+    // square, so it cannot retreat along a checking ray
+    Bitboard occupied = pos->occupancy[OCC_ALL] ^ (1ULL << king);
+    Bitboard steps = KING_ATTACKS[king] & ~own;
+    while (steps) {
+        int to = popLsb(&steps);
+        if (!SIDE_FN(enemyAttackers)(pos, to, occupied)) {
+            addMove(list, king, to, ((enemy >> to) & 1) ? MOVE_CAPTURE : MOVE_QUIET);
+        }
+    }
+
+    // In double check only the king can move
+    if (info.checkers & (info.checkers - 1)) return;
+
+    // Single check: capture the checker or block the ray
+    Bitboard targets = ~own;
+    if (info.checkers) {
+        targets = info.checkers | BETWEEN[king][lsb(info.checkers)];
+    }
+
+    Bitboard pawns = our[W_PAWN - 1];
+    SIDE_FN(generatePawnMoves)(pos, pawns & ~info.pinned, targets, list);
+    Bitboard pinnedPawns = pawns & info.pinned;
+    while (pinnedPawns) {
+        int from = popLsb(&pinnedPawns);
+        SIDE_FN(generatePawnMoves)(pos, 1ULL << from, targets & LINE[king][from], list);
+    }
+    if (pos->enPassantSquare >= 0) {
+        Bitboard attackers = PAWN_ATTACKS[THEM][pos->enPassantSquare] & pawns;
+        while (attackers) {
+            int from = popLsb(&attackers);
+            if (SIDE_FN(isEnPassantLegal)(pos, from, king)) {
+                addMove(list, from, pos->enPassantSquare, MOVE_EN_PASSANT);
+            }
+        }
+    }
+
+    SIDE_FN(generatePieceMoves)(pos, targets, info.pinned, king, list);
+    if (!info.checkers) {
+        SIDE_FN(generateCastling)(pos, list);
+    }
+}
+
+#ifndef CHESS_MOVEGEN_MAILBOX
+// Same masks as generateLegalMoves, but stops at the first legal move and
+// never writes a move list. Castling is skipped: whenever it is legal, so is
+// the king's step onto the square it passes. Only the bitboard backend's
+// hasLegalMoves uses it.
+static int SIDE_FN(hasLegalMoves)(const Position *pos) {
+    const Bitboard *our = pos->bitboards + OUR_PIECES;
+    Bitboard own = pos->occupancy[US];
+    Bitboard occupied = pos->occupancy[OCC_ALL];
+    CheckInfo info;
+
+    if (!our[W_KING - 1]) return 0;
+    SIDE_FN(computeCheckInfo)(pos, &info);
+    int king = info.king;
+
+    Bitboard steps = KING_ATTACKS[king] & ~own;
+    while (steps) {
+        if (!SIDE_FN(enemyAttackers)(pos, popLsb(&steps), occupied ^ (1ULL << king))) return 1;
+    }
+    if (info.checkers & (info.checkers - 1)) return 0;
+
+    Bitboard targets = ~own;
+    if (info.checkers) {
+        targets = info.checkers | BETWEEN[king][lsb(info.checkers)];
+    }
+
+    Bitboard pieces = our[W_KNIGHT - 1] & ~info.pinned;
+    while (pieces) {
+        if (KNIGHT_ATTACKS[popLsb(&pieces)] & targets) return 1;
+    }
+    pieces = our[W_BISHOP - 1] | our[W_QUEEN - 1];
+    while (pieces) {
+        int from = popLsb(&pieces);
+        Bitboard allowed = ((info.pinned >> from) & 1) ? targets & LINE[king][from] : targets;
+        if (bishopAttacks(from, occupied) & allowed) return 1;
+    }
+    pieces = our[W_ROOK - 1] | our[W_QUEEN - 1];
+    while (pieces) {
+        int from = popLsb(&pieces);
+        Bitboard allowed = ((info.pinned >> from) & 1) ? targets & LINE[king][from] : targets;
+        if (rookAttacks(from, occupied) & allowed) return 1;
+    }
+
+    // Pawns, set-wise: unpinned pushes and captures, then pinned pawns along
+    // their pin line
+    Bitboard pawns = our[W_PAWN - 1];
+    Bitboard empty = ~occupied;
+    Bitboard enemy = pos->occupancy[THEM];
+    Bitboard unpinned = pawns & ~info.pinned;
+    Bitboard single = PUSH(unpinned) & empty;
+    if ((single | PUSH(single & DOUBLE_PUSH_RANK)) & empty & targets) return 1;
+    if ((CAPTURE_WEST(unpinned) | CAPTURE_EAST(unpinned)) & enemy & targets) return 1;
+    Bitboard pinnedPawns = pawns & info.pinned;
+    while (pinnedPawns) {
+        int from = popLsb(&pinnedPawns);
+        Bitboard pawn = 1ULL << from;
+        Bitboard allowed = targets & LINE[king][from];
+        single = PUSH(pawn) & empty;
+        if ((single | PUSH(single & DOUBLE_PUSH_RANK)) & empty & allowed) return 1;
+        if ((CAPTURE_WEST(pawn) | CAPTURE_EAST(pawn)) & enemy & allowed) return 1;
+    }
+    if (pos->enPassantSquare >= 0) {
+        Bitboard attackers = PAWN_ATTACKS[THEM][pos->enPassantSquare] & pawns;
+        while (attackers) {
+            if (SIDE_FN(isEnPassantLegal)(pos, popLsb(&attackers), king)) return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
+#undef US
+#undef THEM
+#undef OUR_PIECES
+#undef THEIR_PIECES
+#undef PUSH
+#undef CAPTURE_WEST
+#undef CAPTURE_EAST
+#undef UP
+#undef WEST
+#undef EAST
+#undef DOUBLE_PUSH_RANK
+#undef PROMOTION_RANK
+#undef BACK_ROW
+#undef OUR_ROOK
+#undef OUR_KING
+#undef KINGSIDE_RIGHT
+#undef QUEENSIDE_RIGHT
+#undef KING_HOME
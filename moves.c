@@ -4,6 +4,13 @@
 #include <string.h>
 #include <stdint.h>
 #include "chess.h"
+#include "bitboard.h"
+#include "geometry_tables.h"
+#include "movegen.h"
+#include "counters.h"
+#include "profiler.h"
+#include "trace.h"
+#include "transposition.h"
 
 // Add global flags for GUI notifications of special moves and states
 int enPassantCaptureExecuted = 0;
@@ -13,190 +20,163 @@ int checkFlag = 0;
 int checkMateFlag = 0;
 int stalemateFlag = 0;
 
-// 50-move rule counter
-int fiftyMoveCounter = 0;
+// Castling rights that survive a move touching each square (king and rook homes)
+static const uint8_t castlingRightsMask[64] = {
+    [SQUARE(0, 0)] = (uint8_t)~CASTLE_WHITE_QUEENSIDE,
+    [SQUARE(0, 4)] = (uint8_t)~(CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE),
+    [SQUARE(0, 7)] = (uint8_t)~CASTLE_WHITE_KINGSIDE,
+    [SQUARE(7, 0)] = (uint8_t)~CASTLE_BLACK_QUEENSIDE,
+    [SQUARE(7, 4)] = (uint8_t)~(CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE),
+    [SQUARE(7, 7)] = (uint8_t)~CASTLE_BLACK_KINGSIDE,
+};
 
-// Threefold repetition tracking
-unsigned long long positionHashes[MAX_REPETITIONS];
-int repetitionCount = 0;
+static inline uint8_t castlingRightsAfter(int sq) {
+    // Squares not listed above keep every right
+    return castlingRightsMask[sq] ? castlingRightsMask[sq] : 0xFF;
+}
 
-// --- Bitboard representation for speed optimization ---
-Bitboard bitboards[12] = {0}; // 0-5: white, 6-11: black (K,Q,R,B,N,P)
+int isSquareOccupied(const Position *pos, int row, int col) {
+    return (pos->occupancy[OCC_ALL] & (1ULL << SQUARE(row, col))) != 0;
+}
 
-static int pieceToBitboardIndex(wchar_t piece) {
-    switch (piece) {
-        case white_king:   return 0;
-        case white_queen:  return 1;
-        case white_rook:   return 2;
-        case white_bishop: return 3;
-        case white_knight: return 4;
-        case white_pawn:   return 5;
-        case black_king:   return 6;
-        case black_queen:  return 7;
-        case black_rook:   return 8;
-        case black_bishop: return 9;
-        case black_knight: return 10;
-        case black_pawn:   return 11;
-        default: return -1;
-    }
+// Function to check for 50-move rule draw
+int isFiftyMoveRuleDraw(const Position *pos) {
+    return pos->fiftyMoveCounter >= 100;
 }
 
-void initBitboards() {
-    memset(bitboards, 0, sizeof(bitboards));
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            wchar_t piece = board[row][col];
-            int idx = pieceToBitboardIndex(piece);
-            if (idx >= 0) {
-                bitboards[idx] |= (1ULL << (row * 8 + col));
-            }
+// Full Zobrist key of a position: pieces, castling rights, en passant file and
+// side to move. Moves update pos->key incrementally; this is for setup and checks.
+uint64_t computeZobristKey(const Position *pos) {
+    uint64_t key = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        int piece = pos->squares[sq];
+        if (piece != NO_PIECE) {
+            key ^= ZOBRIST_PIECE[piece - 1][sq];
         }
     }
+    key ^= ZOBRIST_CASTLING[pos->castlingRights];
+    if (pos->enPassantSquare >= 0) {
+        key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(pos->enPassantSquare)];
+    }
+    if (!pos->sideToMove) {
+        key ^= ZOBRIST_SIDE;
+    }
+    return key;
 }
 
-void updateBitboards() {
-    initBitboards();
+// Hash of the current position (the incrementally maintained Zobrist key)
+unsigned long long computeBoardHash(const Position *pos) {
+    return pos->key;
 }
 
-int isSquareOccupied(int row, int col) {
-    for (int i = 0; i < 12; ++i) {
-        if (bitboards[i] & (1ULL << (row * 8 + col)))
-            return 1;
+void pushPositionKey(HashHistory *history, uint64_t key) {
+    if (history->count == history->capacity) {
+        int capacity = history->capacity ? history->capacity * 2 : 256;
+        uint64_t *keys = realloc(history->keys, capacity * sizeof(uint64_t));
+        // A dropped key would leave the stack out of step with its pops and
+        // the game record, and repetition checks would read the wrong entries
+        if (!keys) abort();
+        history->keys = keys;
+        history->capacity = capacity;
     }
-    return 0;
+    history->keys[history->count++] = key;
 }
 
-// Helper functions for piece identification
-int isPieceWhite(wchar_t piece) {
-    return piece >= white_king && piece <= white_pawn;
-}
-
-int isPieceBlack(wchar_t piece) {
-    return piece >= black_king && piece <= black_pawn;
-}
-
-// New helper: check if a square is attacked by opponent pieces.
-// defenderIsWhite indicates the color of the king that would occupy the square.
-static int isSquareAttacked(int row, int col, int defenderIsWhite) {
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            wchar_t piece = board[i][j];
-            if (piece == 0) continue;
-            // Only consider opponent pieces.
-            if (defenderIsWhite && isPieceBlack(piece)) {
-                // Use isValidMove but skip castling (assume king moves only one square).
-                if ( (abs(i - row) <= 1 && abs(j - col) <= 1 && piece == black_king) ||
-                     (piece != black_king && isValidMove(i, j, row, col)) ) {
-                    return 1;
-                }
-            } else if (!defenderIsWhite && isPieceWhite(piece)) {
-                if ( (abs(i - row) <= 1 && abs(j - col) <= 1 && piece == white_king) ||
-                     (piece != white_king && isValidMove(i, j, row, col)) ) {
-                    return 1;
-                }
-            }
-        }
-    }
-    return 0;
-}
+// How many earlier positions match the newest key, up to limit. Nothing can
+// repeat across a pawn move or capture, so only the last fiftyMoveCounter
+// plies are searched, and only every second one (same side to move).
+static int countEarlierRepetitions(const HashHistory *history, int fiftyMoveCounter, int limit) {
+    int newest = history->count - 1;
+    int oldest = newest - fiftyMoveCounter;
+    int found = 0;
+    if (newest < 0) return 0;
+    if (oldest < 0) oldest = 0;
 
-// Fast attack check using bitboards for knights and pawns (partial optimization)
-int isSquareAttackedBB(int row, int col, int defenderIsWhite) {
-    // Knight moves
-    static const int knightMoves[8][2] = {
-        {2,1},{1,2},{-1,2},{-2,1},{-2,-1},{-1,-2},{1,-2},{2,-1}
-    };
-    int attackerIdx = defenderIsWhite ? 10 : 4; // black_knight or white_knight
-    for (int i = 0; i < 8; ++i) {
-        int r = row + knightMoves[i][0];
-        int c = col + knightMoves[i][1];
-        if (r >= 0 && r < 8 && c >= 0 && c < 8) {
-            if (bitboards[attackerIdx] & (1ULL << (r * 8 + c)))
-                return 1;
-        }
+    uint64_t key = history->keys[newest];
+    for (int i = newest - 2; i >= oldest; i -= 2) {
+        if (history->keys[i] == key && ++found >= limit) break;
     }
-    // Pawn attacks
-    if (defenderIsWhite) {
-        // black pawn attacks down
-        if (row > 0 && col > 0 && (bitboards[11] & (1ULL << ((row-1)*8 + (col-1))))) return 1;
-        if (row > 0 && col < 7 && (bitboards[11] & (1ULL << ((row-1)*8 + (col+1))))) return 1;
-    } else {
-        // white pawn attacks up
-        if (row < 7 && col > 0 && (bitboards[5] & (1ULL << ((row+1)*8 + (col-1))))) return 1;
-        if (row < 7 && col < 7 && (bitboards[5] & (1ULL << ((row+1)*8 + (col+1))))) return 1;
-    }
-    // For other pieces, fallback to slow path (could be optimized further)
-    return isSquareAttacked(row, col, defenderIsWhite);
+    return found;
 }
 
-// Function to check for 50-move rule draw
-int isFiftyMoveRuleDraw() {
-    return fiftyMoveCounter >= 100;
+// Newest position seen before: enough for search to score it as a draw
+int isRepetition(const HashHistory *history, int fiftyMoveCounter) {
+    COUNT_EVENT(COUNTER_REPETITION_PROBES);
+    return countEarlierRepetitions(history, fiftyMoveCounter, 1) > 0;
 }
 
-// Simple board hash: XOR all pieces and castling/en passant state
-unsigned long long computeBoardHash() {
-    unsigned long long hash = 0xcbf29ce484222325ULL; // FNV offset basis
-    for (int row = 0; row < 8; ++row) {
-        for (int col = 0; col < 8; ++col) {
-            hash ^= (unsigned long long)board[row][col] + 0x9e3779b9 + (hash << 6) + (hash >> 2);
-        }
+void recordPositionHash(Position *pos) {
+    if (pos->record) {
+        pushPositionKey(&pos->record->positions, pos->key);
     }
-    // Include castling rights and en passant
-    hash ^= (whiteKingMoved << 1) | (whiteKingRookMoved << 2) | (whiteQueenRookMoved << 3);
-    hash ^= (blackKingMoved << 4) | (blackKingRookMoved << 5) | (blackQueenRookMoved << 6);
-    hash ^= ((enPassantTargetRow & 0xF) << 8) | ((enPassantTargetCol & 0xF) << 12);
-    return hash;
 }
 
-void recordPositionHash() {
-    if (repetitionCount < MAX_REPETITIONS) {
-        positionHashes[repetitionCount++] = computeBoardHash();
-    }
+// The current position (the newest recorded) has occurred twice before
+int isThreefoldRepetition(const Position *pos) {
+    const GameRecord *record = pos->record;
+    if (!record) return 0;
+    return countEarlierRepetitions(&record->positions, pos->fiftyMoveCounter, 2) >= 2;
 }
 
-int isThreefoldRepetition() {
-    unsigned long long current = computeBoardHash();
-    int count = 0;
-    for (int i = 0; i < repetitionCount; ++i) {
-        if (positionHashes[i] == current) {
-            count++;
+// Append a move to the game record, before it is played: its text is written
+// now, from the position it is played from, and added to the history text.
+// The lists grow together; a move takes at most 7 characters of history.
+void recordMove(Position *pos, Move m) {
+    GameRecord *record = pos->record;
+    if (!record) return;
+
+    if (record->moveCount == record->moveCapacity) {
+        int capacity = record->moveCapacity ? record->moveCapacity * 2 : 256;
+        Move *moves = realloc(record->moves, capacity * sizeof(Move));
+        if (moves) record->moves = moves;
+        char (*texts)[8] = realloc(record->moveTexts, capacity * sizeof(*texts));
+        if (texts) record->moveTexts = texts;
+        char *history = realloc(record->historyText, (size_t)capacity * 7 + 1);
+        if (history) record->historyText = history;
+        if (!moves || !texts || !history) {
+            printf("Error: Could not grow the move history\n");
+            return;
         }
+        record->moveCapacity = capacity;
     }
-    return count >= 3;
+    char *text = record->moveTexts[record->moveCount];
+    formatMove(pos, m, text);
+    record->moves[record->moveCount++] = m;
+
+    size_t length = strlen(text);
+    memcpy(record->historyText + record->historyLength, text, length);
+    record->historyLength += length;
+    record->historyText[record->historyLength++] = ' ';
+    record->historyText[record->historyLength] = '\0';
 }
 
-// Function to record a move in chess notation
-void recordMove(int fromRow, int fromCol, int toRow, int toCol) {
-    char moveStr[16];
-    wchar_t piece = board[fromRow][fromCol];
-
-    // Get piece character for notation
-    char pieceChar = ' ';
-    if (piece == white_rook || piece == black_rook) pieceChar = 'R';
-    else if (piece == white_knight || piece == black_knight) pieceChar = 'N';
-    else if (piece == white_bishop || piece == black_bishop) pieceChar = 'B';
-    else if (piece == white_queen || piece == black_queen) pieceChar = 'Q';
-    else if (piece == white_king || piece == black_king) pieceChar = 'K';
+// Write a move in the history's notation ("e2e4", "Ng1f3", "e7e8=N") for the
+// position it is played from
+void formatMove(const Position *pos, Move m, char out[8]) {
+    static const char pieceChars[13] = {0, 'K', 'Q', 'R', 'B', 'N', 0, 'K', 'Q', 'R', 'B', 'N', 0};
+    int from = MOVE_FROM(m), to = MOVE_TO(m);
+    char pieceChar = pieceChars[pos->squares[from]];
 
     // For pawns, we don't use a piece character in notation
-    if (pieceChar == ' ') {
-        sprintf(moveStr, "%c%d%c%d ",
-                'a' + fromCol, fromRow + 1,
-                'a' + toCol, toRow + 1);
+    if (pieceChar) {
+        sprintf(out, "%c%c%d%c%d", pieceChar, 'a' + SQUARE_COL(from), SQUARE_ROW(from) + 1,
+                'a' + SQUARE_COL(to), SQUARE_ROW(to) + 1);
     } else {
-        sprintf(moveStr, "%c%c%d%c%d ",
-                pieceChar, 'a' + fromCol, fromRow + 1,
-                'a' + toCol, toRow + 1);
+        sprintf(out, "%c%d%c%d", 'a' + SQUARE_COL(from), SQUARE_ROW(from) + 1,
+                'a' + SQUARE_COL(to), SQUARE_ROW(to) + 1);
+        if (MOVE_IS_PROMOTION(m)) sprintf(out + 4, "=%c", "NBRQ"[MOVE_KIND(m) & 3]);
     }
+}
 
-    // Append the move to the history
-    strcat(moveHistory, moveStr);
+// Text of one recorded move, as written when it was recorded
+void formatRecordedMove(const GameRecord *record, int index, char out[8]) {
+    memcpy(out, record->moveTexts[index], 8);
 }
 
 // Print the move history
-void printMoveHistory() {
-    printf("Move History: %s\n", moveHistory);
+void printMoveHistory(const Position *pos) {
+    const GameRecord *record = pos->record;
+    printf("Move History: %s\n", record && record->historyText ? record->historyText : "");
 }
 
 // Read a move from the command line (format: e2e4)
@@ -244,57 +224,39 @@ int readMove(int *fromRow, int *fromCol, int *toRow, int *toCol) {
     return 1;
 }
 
-// Check if path is clear for pieces that move in straight lines
-int isPathClear(int fromRow, int fromCol, int toRow, int toCol) {
-    int rowStep = 0, colStep = 0;
-
-    if (fromRow < toRow) rowStep = 1;
-    else if (fromRow > toRow) rowStep = -1;
-
-    if (fromCol < toCol) colStep = 1;
-    else if (fromCol > toCol) colStep = -1;
-
-    int row = fromRow + rowStep;
-    int col = fromCol + colStep;
-
-    while (row != toRow || col != toCol) {
-        if (board[row][col] != 0) {
-            return 0; // Path is blocked
-        }
-        row += rowStep;
-        col += colStep;
-    }
-
-    return 1; // Path is clear
+// Check if path is clear for pieces that move in straight lines.
+// Squares that share no line have nothing in between and count as clear.
+int isPathClear(const Position *pos, int fromRow, int fromCol, int toRow, int toCol) {
+    return (BETWEEN[SQUARE(fromRow, fromCol)][SQUARE(toRow, toCol)] & pos->occupancy[OCC_ALL]) == 0;
 }
 
 // Modified pawn move validity function to support en passant capture
-int isPawnMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
-    int direction = (piece == white_pawn) ? 1 : -1;
-    int startRow = (piece == white_pawn) ? 1 : 6;
+int isPawnMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    int direction = (piece == W_PAWN) ? 1 : -1;
+    int startRow = (piece == W_PAWN) ? 1 : 6;
 
     // Forward move (1 square)
-    if (fromCol == toCol && toRow == fromRow + direction && board[toRow][toCol] == 0) {
+    if (fromCol == toCol && toRow == fromRow + direction && pos->squares[SQUARE(toRow, toCol)] == NO_PIECE) {
         return 1;
     }
 
     // Forward move (2 squares from starting position)
     if (fromCol == toCol && fromRow == startRow && toRow == fromRow + 2 * direction &&
-        board[fromRow + direction][fromCol] == 0 && board[toRow][toCol] == 0) {
+        pos->squares[SQUARE(fromRow + direction, fromCol)] == NO_PIECE &&
+        pos->squares[SQUARE(toRow, toCol)] == NO_PIECE) {
         return 1;
     }
 
     // Capture move (including en passant)
-    if (abs(fromCol - toCol) == 1 && toRow == fromRow + direction) {
-        wchar_t targetPiece = board[toRow][toCol];
+    if (PAWN_ATTACKS[piece == W_PAWN ? OCC_WHITE : OCC_BLACK][SQUARE(fromRow, fromCol)] & (1ULL << SQUARE(toRow, toCol))) {
+        int targetPiece = pos->squares[SQUARE(toRow, toCol)];
         // Normal capture
-        if ((piece == white_pawn && isPieceBlack(targetPiece)) ||
-            (piece == black_pawn && isPieceWhite(targetPiece))) {
+        if ((piece == W_PAWN && PIECE_IS_BLACK(targetPiece)) ||
+            (piece == B_PAWN && PIECE_IS_WHITE(targetPiece))) {
             return 1;
         }
         // En passant capture: if target square is empty and matches enPassant target
-        if (targetPiece == 0 &&
-            toRow == enPassantTargetRow && toCol == enPassantTargetCol) {
+        if (targetPiece == NO_PIECE && SQUARE(toRow, toCol) == pos->enPassantSquare) {
             return 1;
         }
     }
@@ -303,78 +265,76 @@ int isPawnMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
 }
 
 // Check rook move validity
-int isRookMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
-    // Rook moves in straight lines (horizontally or vertically)
-    if (fromRow != toRow && fromCol != toCol) {
-        return 0;
-    }
-
-    return isPathClear(fromRow, fromCol, toRow, toCol);
+int isRookMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    (void)piece;   // unused, but every piece validator takes the same arguments
+    // Rook moves in straight lines (horizontally or vertically) up to the first blocker
+    return (rookAttacks(SQUARE(fromRow, fromCol), pos->occupancy[OCC_ALL]) >> SQUARE(toRow, toCol)) & 1;
 }
 
 // Check knight move validity
-int isKnightMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
+int isKnightMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    (void)piece;
+    (void)pos;
     // Knight moves in L shape (2 in one direction, 1 in perpendicular direction)
-    int rowDiff = abs(fromRow - toRow);
-    int colDiff = abs(fromCol - toCol);
-
-    return (rowDiff == 2 && colDiff == 1) || (rowDiff == 1 && colDiff == 2);
+    return (KNIGHT_ATTACKS[SQUARE(fromRow, fromCol)] >> SQUARE(toRow, toCol)) & 1;
 }
 
 // Check bishop move validity
-int isBishopMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
-    // Bishop moves diagonally
-    if (abs(fromRow - toRow) != abs(fromCol - toCol)) {
-        return 0;
-    }
-
-    return isPathClear(fromRow, fromCol, toRow, toCol);
+int isBishopMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    (void)piece;
+    // Bishop moves diagonally up to the first blocker
+    return (bishopAttacks(SQUARE(fromRow, fromCol), pos->occupancy[OCC_ALL]) >> SQUARE(toRow, toCol)) & 1;
 }
 
 // Check queen move validity
-int isQueenMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
+int isQueenMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    (void)piece;
     // Queen can move like a rook or bishop
-    return isRookMove(piece, fromRow, fromCol, toRow, toCol) ||
-           isBishopMove(piece, fromRow, fromCol, toRow, toCol);
+    return (queenAttacks(SQUARE(fromRow, fromCol), pos->occupancy[OCC_ALL]) >> SQUARE(toRow, toCol)) & 1;
 }
 
 // Check king move validity
-int isKingMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
-    int rowDiff = abs(fromRow - toRow);
-    int colDiff = abs(fromCol - toCol);
+int isKingMove(const Position *pos, int piece, int fromRow, int fromCol, int toRow, int toCol) {
+    const uint8_t *sq = pos->squares;
     // Normal one-square king move
-    if(rowDiff <= 1 && colDiff <= 1)
+    if((KING_ATTACKS[SQUARE(fromRow, fromCol)] >> SQUARE(toRow, toCol)) & 1)
         return 1;
     
     // Castling move (king moves two squares horizontally on its starting row)
-    if(rowDiff == 0 && colDiff == 2) {
-         if(piece == white_king && fromRow == 0) {
-              if(toCol == 6 && !whiteKingMoved && !whiteKingRookMoved &&
-                 board[0][5] == 0 && board[0][6] == 0 && board[0][7] == white_rook) {
-                     // For kingside, ensure squares f1 and g1 are not attacked.
-                     if(isSquareAttackedBB(0, 5, 1) || isSquareAttackedBB(0, 6, 1))
+    if(fromRow == toRow && abs(fromCol - toCol) == 2) {
+         if(piece == W_KING && fromRow == 0 && fromCol == 4) {
+              if(toCol == 6 && (pos->castlingRights & CASTLE_WHITE_KINGSIDE) &&
+                 sq[SQUARE(0, 5)] == NO_PIECE && sq[SQUARE(0, 6)] == NO_PIECE && sq[SQUARE(0, 7)] == W_ROOK) {
+                     // For kingside, ensure e1, f1 and g1 are not attacked.
+                     if(isSquareAttackedBB(pos, 0, 4, 1) || isSquareAttackedBB(pos, 0, 5, 1) ||
+                        isSquareAttackedBB(pos, 0, 6, 1))
                          return 0;
                      return 1;
               }
-              else if(toCol == 2 && !whiteKingMoved && !whiteQueenRookMoved &&
-                      board[0][3] == 0 && board[0][2] == 0 && board[0][1] == 0 && board[0][0] == white_rook) {
-                     // For queenside, ensure squares d1 and c1 are not attacked.
-                     if(isSquareAttackedBB(0, 3, 1) || isSquareAttackedBB(0, 2, 1))
+              else if(toCol == 2 && (pos->castlingRights & CASTLE_WHITE_QUEENSIDE) &&
+                      sq[SQUARE(0, 3)] == NO_PIECE && sq[SQUARE(0, 2)] == NO_PIECE &&
+                      sq[SQUARE(0, 1)] == NO_PIECE && sq[SQUARE(0, 0)] == W_ROOK) {
+                     // For queenside, ensure e1, d1 and c1 are not attacked.
+                     if(isSquareAttackedBB(pos, 0, 4, 1) || isSquareAttackedBB(pos, 0, 3, 1) ||
+                        isSquareAttackedBB(pos, 0, 2, 1))
                          return 0;
                      return 1;
               }
-         } else if(piece == black_king && fromRow == 7) {
-              if(toCol == 6 && !blackKingMoved && !blackKingRookMoved &&
-                 board[7][5] == 0 && board[7][6] == 0 && board[7][7] == black_rook) {
-                     // For kingside, ensure squares f8 and g8 are not attacked.
-                     if(isSquareAttackedBB(7, 5, 0) || isSquareAttackedBB(7, 6, 0))
+         } else if(piece == B_KING && fromRow == 7 && fromCol == 4) {
+              if(toCol == 6 && (pos->castlingRights & CASTLE_BLACK_KINGSIDE) &&
+                 sq[SQUARE(7, 5)] == NO_PIECE && sq[SQUARE(7, 6)] == NO_PIECE && sq[SQUARE(7, 7)] == B_ROOK) {
+                     // For kingside, ensure e8, f8 and g8 are not attacked.
+                     if(isSquareAttackedBB(pos, 7, 4, 0) || isSquareAttackedBB(pos, 7, 5, 0) ||
+                        isSquareAttackedBB(pos, 7, 6, 0))
                          return 0;
                      return 1;
               }
-              else if(toCol == 2 && !blackKingMoved && !blackQueenRookMoved &&
-                      board[7][3] == 0 && board[7][2] == 0 && board[7][1] == 0 && board[7][0] == black_rook) {
-                     // For queenside, ensure squares d8 and c8 are not attacked.
-                     if(isSquareAttackedBB(7, 3, 0) || isSquareAttackedBB(7, 2, 0))
+              else if(toCol == 2 && (pos->castlingRights & CASTLE_BLACK_QUEENSIDE) &&
+                      sq[SQUARE(7, 3)] == NO_PIECE && sq[SQUARE(7, 2)] == NO_PIECE &&
+                      sq[SQUARE(7, 1)] == NO_PIECE && sq[SQUARE(7, 0)] == B_ROOK) {
+                     // For queenside, ensure e8, d8 and c8 are not attacked.
+                     if(isSquareAttackedBB(pos, 7, 4, 0) || isSquareAttackedBB(pos, 7, 3, 0) ||
+                        isSquareAttackedBB(pos, 7, 2, 0))
                          return 0;
                      return 1;
               }
@@ -384,162 +344,203 @@ int isKingMove(wchar_t piece, int fromRow, int fromCol, int toRow, int toCol) {
 }
 
 // Validate if a move is legal
-int isValidMove(int fromRow, int fromCol, int toRow, int toCol) {
-    wchar_t piece = board[fromRow][fromCol];
-    wchar_t targetPiece = board[toRow][toCol];
+int isValidMove(const Position *pos, int fromRow, int fromCol, int toRow, int toCol) {
+    int piece = pos->squares[SQUARE(fromRow, fromCol)];
+    int targetPiece = pos->squares[SQUARE(toRow, toCol)];
 
     // Check if there is a piece to move
-    if (piece == 0) {
+    if (piece == NO_PIECE) {
         printf("No piece at starting position.\n");
         return 0;
     }
 
     // Check if destination has a piece of the same color
-    if ((isPieceWhite(piece) && isPieceWhite(targetPiece)) ||
-        (isPieceBlack(piece) && isPieceBlack(targetPiece))) {
+    if ((PIECE_IS_WHITE(piece) && PIECE_IS_WHITE(targetPiece)) ||
+        (PIECE_IS_BLACK(piece) && PIECE_IS_BLACK(targetPiece))) {
         printf("Cannot capture own piece.\n");
         return 0;
     }
 
     // Check if move is valid based on piece type
-    if (piece == white_pawn || piece == black_pawn) {
-        return isPawnMove(piece, fromRow, fromCol, toRow, toCol);
-    } else if (piece == white_rook || piece == black_rook) {
-        return isRookMove(piece, fromRow, fromCol, toRow, toCol);
-    } else if (piece == white_knight || piece == black_knight) {
-        return isKnightMove(piece, fromRow, fromCol, toRow, toCol);
-    } else if (piece == white_bishop || piece == black_bishop) {
-        return isBishopMove(piece, fromRow, fromCol, toRow, toCol);
-    } else if (piece == white_queen || piece == black_queen) {
-        return isQueenMove(piece, fromRow, fromCol, toRow, toCol);
-    } else if (piece == white_king || piece == black_king) {
-        return isKingMove(piece, fromRow, fromCol, toRow, toCol);
+    if (piece == W_PAWN || piece == B_PAWN) {
+        return isPawnMove(pos, piece, fromRow, fromCol, toRow, toCol);
+    } else if (piece == W_ROOK || piece == B_ROOK) {
+        return isRookMove(pos, piece, fromRow, fromCol, toRow, toCol);
+    } else if (piece == W_KNIGHT || piece == B_KNIGHT) {
+        return isKnightMove(pos, piece, fromRow, fromCol, toRow, toCol);
+    } else if (piece == W_BISHOP || piece == B_BISHOP) {
+        return isBishopMove(pos, piece, fromRow, fromCol, toRow, toCol);
+    } else if (piece == W_QUEEN || piece == B_QUEEN) {
+        return isQueenMove(pos, piece, fromRow, fromCol, toRow, toCol);
+    } else if (piece == W_KING || piece == B_KING) {
+        return isKingMove(pos, piece, fromRow, fromCol, toRow, toCol);
     }
 
     return 0;
 }
 
-// Execute the move on the board
-void executeMove(int fromRow, int fromCol, int toRow, int toCol) {
-    // Record the move before execution
-    recordMove(fromRow, fromCol, toRow, toCol);
+// Encode a from/to pair on the current board as the generator would:
+// capture, en passant, castling and double-push kinds, and promotion to a queen.
+Move moveFromSquares(const Position *pos, int from, int to) {
+    int piece = pos->squares[from];
+    int kind = pos->squares[to] != NO_PIECE ? MOVE_CAPTURE : MOVE_QUIET;
+
+    if (piece == W_PAWN || piece == B_PAWN) {
+        if (SQUARE_COL(from) != SQUARE_COL(to) && pos->squares[to] == NO_PIECE) {
+            kind = MOVE_EN_PASSANT;
+        } else if (abs(SQUARE_ROW(to) - SQUARE_ROW(from)) == 2) {
+            kind = MOVE_DOUBLE_PUSH;
+        } else if (SQUARE_ROW(to) == 7 || SQUARE_ROW(to) == 0) {
+            kind |= MOVE_PROMOTION | 3;
+        }
+    } else if ((piece == W_KING || piece == B_KING) && abs(SQUARE_COL(to) - SQUARE_COL(from)) == 2) {
+        kind = to > from ? MOVE_KING_CASTLE : MOVE_QUEEN_CASTLE;
+    }
+    return ENCODE_MOVE(from, to, kind);
+}
 
-    // Store the piece being moved and the original destination
-    wchar_t movedPiece = board[fromRow][fromCol];
-    wchar_t targetPiece = board[toRow][toCol];
+// Play a move, saving in undo exactly what unmakeMove needs to take it back:
+// the captured piece, castling rights, en passant square, fifty-move counter
+// and key. The position must have the mover's colour as side to move.
+void makeMove(Position *pos, Move m, Undo *undo) {
+    int from = MOVE_FROM(m), to = MOVE_TO(m), kind = MOVE_KIND(m);
+    int piece = pos->squares[from];
+    int whiteMove = PIECE_IS_WHITE(piece);
+    int capturedSquare = kind == MOVE_EN_PASSANT ? to + (whiteMove ? -8 : 8) : to;
+
+    undo->captured = pos->squares[capturedSquare];
+    undo->castlingRights = pos->castlingRights;
+    undo->enPassantSquare = pos->enPassantSquare;
+    undo->fiftyMoveCounter = pos->fiftyMoveCounter;
+    undo->key = pos->key;
 
-    // --- 50-move rule logic ---
     // Reset counter if pawn move or capture, else increment
-    if ((movedPiece == white_pawn || movedPiece == black_pawn) || (targetPiece != 0)) {
-        fiftyMoveCounter = 0;
+    if (piece == W_PAWN || piece == B_PAWN || undo->captured != NO_PIECE) {
+        pos->fiftyMoveCounter = 0;
     } else {
-        fiftyMoveCounter++;
+        pos->fiftyMoveCounter++;
     }
 
-    // For pawns: set en passant target if moving two squares, else reset targets
-    if((movedPiece == white_pawn && (toRow - fromRow) == 2) ||
-       (movedPiece == black_pawn && (fromRow - toRow) == 2)) {
-         enPassantTargetRow = (fromRow + toRow) / 2;
-         enPassantTargetCol = fromCol;
+    pos->key ^= ZOBRIST_CASTLING[pos->castlingRights];
+    if (pos->enPassantSquare >= 0) {
+        pos->key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(pos->enPassantSquare)];
+    }
+    pos->enPassantSquare = -1;
+
+    if (undo->captured != NO_PIECE) {
+        removePiece(pos, capturedSquare);
+    }
+    movePiece(pos, from, to);
+
+    if (kind & MOVE_PROMOTION) {
+        removePiece(pos, to);
+        putPiece(pos, to, movePromotionPiece(m, whiteMove));
+    } else if (kind == MOVE_KING_CASTLE) {
+        // The rook jumps over the king: h-file rook to f, a-file rook to d
+        movePiece(pos, from + 3, from + 1);
+    } else if (kind == MOVE_QUEEN_CASTLE) {
+        movePiece(pos, from - 4, from - 1);
+    } else if (kind == MOVE_DOUBLE_PUSH) {
+        // Only keep an en passant target an enemy pawn can actually use, so
+        // the hash does not split otherwise identical positions
+        int target = (from + to) / 2;
+        Bitboard enemyPawns = pos->bitboards[whiteMove ? B_PAWN - 1 : W_PAWN - 1];
+        if (PAWN_ATTACKS[whiteMove ? OCC_WHITE : OCC_BLACK][target] & enemyPawns) {
+            pos->enPassantSquare = (int8_t)target;
+            pos->key ^= ZOBRIST_EN_PASSANT[SQUARE_COL(target)];
+        }
+    }
+
+    // Moving a king or rook, or capturing on a rook's home square, loses castling rights
+    pos->castlingRights &= castlingRightsAfter(from) & castlingRightsAfter(to);
+    pos->key ^= ZOBRIST_CASTLING[pos->castlingRights];
+    pos->sideToMove = (uint8_t)!whiteMove;
+    pos->key ^= ZOBRIST_SIDE;
+}
+
+void unmakeMove(Position *pos, Move m, const Undo *undo) {
+    int from = MOVE_FROM(m), to = MOVE_TO(m), kind = MOVE_KIND(m);
+    int whiteMove = !pos->sideToMove;
+
+    if (kind & MOVE_PROMOTION) {
+        removePiece(pos, to);
+        putPiece(pos, from, whiteMove ? W_PAWN : B_PAWN);
     } else {
-         enPassantTargetRow = -1;
-         enPassantTargetCol = -1;
-    }
-
-    // Execute the move
-    board[toRow][toCol] = movedPiece;
-    board[fromRow][fromCol] = 0;
-
-    // Handle en passant capture:
-    // If a pawn moves diagonally into an empty square (i.e. targetPiece was 0),
-    // capture the opponent's pawn located just behind the destination.
-    if((movedPiece == white_pawn || movedPiece == black_pawn) &&
-       (abs(fromCol - toCol) == 1) && targetPiece == 0) {
-         if(movedPiece == white_pawn) {
-              board[toRow - 1][toCol] = 0;
-         } else if(movedPiece == black_pawn) {
-              board[toRow + 1][toCol] = 0;
-         }
+        movePiece(pos, to, from);
+        if (kind == MOVE_KING_CASTLE) {
+            movePiece(pos, from + 1, from + 3);
+        } else if (kind == MOVE_QUEEN_CASTLE) {
+            movePiece(pos, from - 1, from - 4);
+        }
+    }
+    if (undo->captured != NO_PIECE) {
+        putPiece(pos, kind == MOVE_EN_PASSANT ? to + (whiteMove ? -8 : 8) : to, undo->captured);
+    }
+
+    pos->sideToMove = (uint8_t)whiteMove;
+    pos->castlingRights = undo->castlingRights;
+    pos->enPassantSquare = undo->enPassantSquare;
+    pos->fiftyMoveCounter = undo->fiftyMoveCounter;
+    pos->key = undo->key;
+}
+
+// Execute the move on the board; a pawn reaching the last row becomes a queen
+void executeMove(Position *pos, int fromRow, int fromCol, int toRow, int toCol) {
+    playMove(pos, moveFromSquares(pos, SQUARE(fromRow, fromCol), SQUARE(toRow, toCol)));
+}
+
+// Play an encoded move in the game, keeping its promotion piece
+void playMove(Position *pos, Move m) {
+    int from = MOVE_FROM(m);
+    Undo undo;
+
+    // Record the move before execution
+    recordMove(pos, m);
+
+    // Get the color of the player who is moving; the GUI and the API may hand
+    // over a move for either side, so line the position up with it first
+    int whiteMove = PIECE_IS_WHITE(pos->squares[from]);
+    if (pos->sideToMove != whiteMove) {
+        pos->sideToMove = (uint8_t)whiteMove;
+        pos->key ^= ZOBRIST_SIDE;
+    }
+
+    makeMove(pos, m, &undo);
+
+    if (MOVE_KIND(m) == MOVE_EN_PASSANT) {
          printf("En passant capture executed!\n");
          enPassantCaptureExecuted = 1;
     }
-
-    // Handle castling: if the king moves two squares horizontally, move the rook accordingly.
-    if(movedPiece == white_king && abs(fromCol - toCol) == 2 && fromRow == 0) {
-         if(toCol == 6) {  // White kingside castling
-              board[0][5] = board[0][7];
-              board[0][7] = 0;
-              whiteKingRookMoved = 1;
-         } else if(toCol == 2) {  // White queenside castling
-              board[0][3] = board[0][0];
-              board[0][0] = 0;
-              whiteQueenRookMoved = 1;
-         }
-         whiteKingMoved = 1;
-         castlingExecuted = 1;
-    } else if(movedPiece == black_king && abs(fromCol - toCol) == 2 && fromRow == 7) {
-         if(toCol == 6) {  // Black kingside castling
-              board[7][5] = board[7][7];
-              board[7][7] = 0;
-              blackKingRookMoved = 1;
-         } else if(toCol == 2) {  // Black queenside castling
-              board[7][3] = board[7][0];
-              board[7][0] = 0;
-              blackQueenRookMoved = 1;
-         }
-         blackKingMoved = 1;
+    if (MOVE_IS_CASTLE(m)) {
          castlingExecuted = 1;
     }
-    // Pawn promotion
-    if(board[toRow][toCol] == white_pawn && toRow == 7) {
-         board[toRow][toCol] = white_queen;  // Automatically promote to queen
-         printf("Pawn promoted to Queen!\n");
-         promotionExecuted = 1;
-    } else if(board[toRow][toCol] == black_pawn && toRow == 0) {
-         board[toRow][toCol] = black_queen;  // Automatically promote to queen
-         printf("Pawn promoted to Queen!\n");
+    if (MOVE_IS_PROMOTION(m)) {
+         static const char *promotionNames[4] = {"Knight", "Bishop", "Rook", "Queen"};
+         printf("Pawn promoted to %s!\n", promotionNames[MOVE_KIND(m) & 3]);
          promotionExecuted = 1;
     }
 
-    // Get the color of the player who just moved
-    int whiteMove = isPieceWhite(movedPiece);
-    
     // Clear previous state flags
     checkFlag = 0;
     checkMateFlag = 0;
     stalemateFlag = 0;
     
-    // Check if opponent's king is in check after this move
-    int opponentIsWhite = !whiteMove;
-    if (isKingInCheck(opponentIsWhite)) {
-        if (isCheckMate(opponentIsWhite)) {
-            checkMateFlag = 1;
-        } else {
-            checkFlag = 1;
-        }
-    } else if (isStaleMate(opponentIsWhite)) {
-        stalemateFlag = 1;
-    }
-
     // Record position hash for threefold repetition
-    recordPositionHash();
-
-    // Check for 50-move rule draw
-    if (isFiftyMoveRuleDraw()) {
+    recordPositionHash(pos);
+
+    // Everything about the opponent's reply is answered by one status lookup;
+    // 50-move and threefold repetition draws come after checkmate
+    GameStatus status = getGameStatus(pos);
+    if (status.checkmate) {
+        checkMateFlag = 1;
+    } else if (status.stalemate || status.fiftyMoveDraw || status.repetitionDraw) {
         stalemateFlag = 1;
-        return;
+    } else if (status.inCheck) {
+        checkFlag = 1;
     }
-    // Check for threefold repetition draw
-    if (isThreefoldRepetition()) {
-        stalemateFlag = 1;
-        return;
-    }
-
-    // Update bitboards after move
-    updateBitboards();
 }
 
-// --- Local CPU (minimax with alpha-beta pruning and iterative deepening) ---
+// --- Local CPU (principal variation search with iterative deepening and aspiration windows) ---
 
 // Piece-square tables (simplified, midgame, white's perspective; black is mirrored)
 static const int pawn_table[8][8] = {
@@ -607,7 +608,9 @@ static const int king_table[8][8] = {
 static inline int mirror_row(int row) { return 7 - row; }
 
 // Refined evaluation function using Shannon's formula and piece-square tables
-int evaluateBoard() {
+int evaluateBoard(const Position *pos) {
+    COUNT_EVENT(COUNTER_EVALUATIONS);
+
     // Piece values
     const int PAWN_VALUE = 100;
     const int KNIGHT_VALUE = 320;
@@ -620,55 +623,55 @@ int evaluateBoard() {
 
     for (int row = 0; row < 8; ++row) {
         for (int col = 0; col < 8; ++col) {
-            wchar_t piece = board[row][col];
-            if (piece == 0) continue;
+            int piece = pos->squares[SQUARE(row, col)];
+            if (piece == NO_PIECE) continue;
             int value = 0, psq = 0;
             switch (piece) {
-                case white_pawn:
+                case W_PAWN:
                     value = PAWN_VALUE;
                     psq = pawn_table[row][col];
                     break;
-                case black_pawn:
+                case B_PAWN:
                     value = -PAWN_VALUE;
                     psq = -pawn_table[mirror_row(row)][col];
                     break;
-                case white_knight:
+                case W_KNIGHT:
                     value = KNIGHT_VALUE;
                     psq = knight_table[row][col];
                     break;
-                case black_knight:
+                case B_KNIGHT:
                     value = -KNIGHT_VALUE;
                     psq = -knight_table[mirror_row(row)][col];
                     break;
-                case white_bishop:
+                case W_BISHOP:
                     value = BISHOP_VALUE;
                     psq = bishop_table[row][col];
                     break;
-                case black_bishop:
+                case B_BISHOP:
                     value = -BISHOP_VALUE;
                     psq = -bishop_table[mirror_row(row)][col];
                     break;
-                case white_rook:
+                case W_ROOK:
                     value = ROOK_VALUE;
                     psq = rook_table[row][col];
                     break;
-                case black_rook:
+                case B_ROOK:
                     value = -ROOK_VALUE;
                     psq = -rook_table[mirror_row(row)][col];
                     break;
-                case white_queen:
+                case W_QUEEN:
                     value = QUEEN_VALUE;
                     psq = queen_table[row][col];
                     break;
-                case black_queen:
+                case B_QUEEN:
                     value = -QUEEN_VALUE;
                     psq = -queen_table[mirror_row(row)][col];
                     break;
-                case white_king:
+                case W_KING:
                     value = KING_VALUE;
                     psq = king_table[row][col];
                     break;
-                case black_king:
+                case B_KING:
                     value = -KING_VALUE;
                     psq = -king_table[mirror_row(row)][col];
                     break;
@@ -679,153 +682,379 @@ int evaluateBoard() {
 
     // Optionally, add simple bonuses/penalties for castling rights, doubled pawns, etc.
 
-    // Checkmate/stalemate detection for terminal positions
-    if (isCheckMate(0)) return -100000; // White is checkmated
-    if (isCheckMate(1)) return 100000;  // Black is checkmated
-    if (isStaleMate(0) || isStaleMate(1)) return 0; // Draw
+    // Checkmate/stalemate detection for terminal positions; only the side to
+    // move can be mated or stalemated
+    GameStatus status = getGameStatus(pos);
+    if (status.checkmate) return pos->sideToMove ? -MATE_SCORE : MATE_SCORE;
+    if (status.stalemate) return 0; // Draw
 
     return score;
 }
 
-// Move representation for fast move generation
-typedef struct {
-    int fromRow, fromCol, toRow, toCol;
-    int captureValue; // For move ordering: higher is better
-} Move;
-
-// Generate all legal moves for a player (0=white, 1=black), returns count
-static int generateLegalMoves(int playerIsWhite, Move moves[], int maxMoves) {
-    int count = 0;
-    for (int fr = 0; fr < 8; ++fr) {
-        for (int fc = 0; fc < 8; ++fc) {
-            wchar_t piece = board[fr][fc];
-            if (piece == 0) continue;
-            if (playerIsWhite ? !isPieceWhite(piece) : !isPieceBlack(piece)) continue;
-            for (int tr = 0; tr < 8; ++tr) {
-                for (int tc = 0; tc < 8; ++tc) {
-                    if (fr == tr && fc == tc) continue;
-                    wchar_t target = board[tr][tc];
-                    if ((playerIsWhite && isPieceWhite(target)) || (!playerIsWhite && isPieceBlack(target)))
-                        continue;
-                    if (!isValidMove(fr, fc, tr, tc)) continue;
-                    if (moveWouldExposeCheck(fr, fc, tr, tc, playerIsWhite)) continue;
-                    // Don't allow capturing the king (illegal in chess)
-                    if (target == white_king || target == black_king) continue;
-                    if (count < maxMoves) {
-                        moves[count].fromRow = fr;
-                        moves[count].fromCol = fc;
-                        moves[count].toRow = tr;
-                        moves[count].toCol = tc;
-                        // Prefer captures for move ordering
-                        moves[count].captureValue = 0;
-                        if (target != 0) {
-                            // Assign higher value for capturing more valuable pieces
-                            if (target == white_queen || target == black_queen) moves[count].captureValue = 9;
-                            else if (target == white_rook || target == black_rook) moves[count].captureValue = 5;
-                            else if (target == white_bishop || target == black_bishop ||
-                                     target == white_knight || target == black_knight) moves[count].captureValue = 3;
-                            else if (target == white_pawn || target == black_pawn) moves[count].captureValue = 1;
-                        }
-                        count++;
-                    }
-                }
+// Ordering value of a captured or promoted-to piece, by piece code
+static const int orderingValue[13] = {0, 0, 9, 5, 3, 3, 1, 0, 9, 5, 3, 3, 1};
+
+// Generate all legal moves for a player (1=white, 0=black) with ordering
+// scores filled in, returns count
+static int generateOrderedMoves(const Position *pos, int playerIsWhite, MoveList *list) {
+    PROFILE_ENTER(PHASE_MOVEGEN);
+    generateLegalMoves(pos, playerIsWhite, list);
+    for (int i = 0; i < list->count; ++i) {
+        Move m = list->moves[i];
+        // Prefer captures of valuable pieces and promotions for move ordering
+        list->scores[i] = orderingValue[MOVE_KIND(m) == MOVE_EN_PASSANT ? W_PAWN : pos->squares[MOVE_TO(m)]];
+        if (MOVE_IS_PROMOTION(m)) {
+            list->scores[i] += orderingValue[movePromotionPiece(m, playerIsWhite)];
+        }
+    }
+    PROFILE_LEAVE();
+    return list->count;
+}
+
+// Sort moves by ordering score (descending) for better alpha-beta pruning
+static void sortMoves(MoveList *list) {
+    PROFILE_ENTER(PHASE_SORT);
+    for (int i = 0; i < list->count - 1; ++i) {
+        for (int j = i + 1; j < list->count; ++j) {
+            if (list->scores[j] > list->scores[i]) {
+                Move move = list->moves[i];
+                int score = list->scores[i];
+                list->moves[i] = list->moves[j];
+                list->scores[i] = list->scores[j];
+                list->moves[j] = move;
+                list->scores[j] = score;
             }
         }
     }
-    return count;
+    PROFILE_LEAVE();
 }
 
-// Sort moves by capture value (descending) for better alpha-beta pruning
-static void sortMoves(Move moves[], int count) {
-    for (int i = 0; i < count - 1; ++i) {
-        for (int j = i + 1; j < count; ++j) {
-            if (moves[j].captureValue > moves[i].captureValue) {
-                Move tmp = moves[i];
-                moves[i] = moves[j];
-                moves[j] = tmp;
+// Move the transposition table's move to the front, keeping the order of the rest
+static void promoteMove(MoveList *list, Move m) {
+    for (int i = 1; i < list->count; ++i) {
+        if (list->moves[i] != m) continue;
+        int score = list->scores[i];
+        memmove(&list->moves[1], &list->moves[0], i * sizeof(Move));
+        memmove(&list->scores[1], &list->scores[0], i * sizeof(int));
+        list->moves[0] = m;
+        list->scores[0] = score;
+        return;
+    }
+}
+
+#define MAX_SEARCH_PLY 64
+#define INFINITE_SCORE (MATE_SCORE + 1)
+#define MATE_BOUND (MATE_SCORE - MAX_SEARCH_PLY)   // scores beyond this are mates
+#define ASPIRATION_DEPTH 3
+#define ASPIRATION_WINDOW 50
+
+// Per-search state: the keys of the game and the current line (newest last),
+// the number of nodes visited and the transposition table use. Besides the
+// position and this context only the transposition table affects the result.
+typedef struct {
+    HashHistory history;
+    unsigned long long nodes;
+    int ply;                        // distance from the root
+    Move line[MAX_SEARCH_PLY];      // moves from the root to the current node
+    unsigned long long hashProbes;
+    unsigned long long hashHits;
+    unsigned long long hashCutoffs;
+} SearchContext;
+
+// Play a move in the search and push the new key. Returns 1 if the position
+// reached is drawn by repetition or the fifty-move rule.
+static int playSearchMove(Position *pos, SearchContext *ctx, Move m, Undo *undo) {
+    PROFILE_ENTER(PHASE_MAKE_UNMAKE);
+    makeMove(pos, m, undo);
+    PROFILE_LEAVE();
+    ctx->line[ctx->ply++] = m;
+    PROFILE_ENTER(PHASE_HASH);
+    // The child's bucket loads while the repetition check runs
+    prefetchTransposition(pos->key);
+    pushPositionKey(&ctx->history, pos->key);
+    int draw = isRepetition(&ctx->history, pos->fiftyMoveCounter) || isFiftyMoveRuleDraw(pos);
+    PROFILE_LEAVE();
+    return draw;
+}
+
+static void takeBackSearchMove(Position *pos, SearchContext *ctx, Move m, const Undo *undo) {
+    popPositionKey(&ctx->history);
+    ctx->ply--;
+    PROFILE_ENTER(PHASE_MAKE_UNMAKE);
+    unmakeMove(pos, m, undo);
+    PROFILE_LEAVE();
+}
+
+// Static score for the side to move. evaluateBoard scores for white and gives
+// every checkmate the same score; here a mate found closer to the root scores
+// higher, so the search prefers the shortest mate and the longest defence.
+static int evaluateLeaf(const Position *pos, int ply) {
+    PROFILE_ENTER(PHASE_EVALUATION);
+    int score = evaluateBoard(pos);
+    PROFILE_LEAVE();
+    if (!pos->sideToMove) score = -score;
+    return score <= -MATE_SCORE ? -MATE_SCORE + ply : score;
+}
+
+// Mate scores count plies from the root; the table keeps them counted from
+// the node, so they stay right wherever the position comes up again
+static int scoreToTransposition(int score, int ply) {
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int scoreFromTransposition(int score, int ply) {
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+static int negamax(Position *pos, SearchContext *ctx, int depth, int alpha, int beta, int flags);
+
+// Play a move, search the position it reaches and take it back. Returns the
+// score for the side that moved. A repeated position or a fifty-move draw
+// ends the line at a draw score. flags marks the child's trace record.
+static int searchMove(Position *pos, SearchContext *ctx, Move m, int depth, int alpha, int beta, int flags) {
+    Undo undo;
+    int score;
+    if (playSearchMove(pos, ctx, m, &undo)) {
+        score = 0;
+        TRACE_NODE(pos->key, ctx->ply, depth, m, -beta, -alpha, score, TRACE_DRAW, flags, 0, TRACE_NO_CUTOFF);
+    } else {
+        score = -negamax(pos, ctx, depth, -beta, -alpha, flags);
+    }
+    takeBackSearchMove(pos, ctx, m, &undo);
+    return score;
+}
+
+// Principal variation search: scores are for the side to move. The first
+// move gets the full window; every later one is first searched with a null
+// window just above alpha, which only proves it no better, and searched again
+// in full only if it turns out better.
+static int negamax(Position *pos, SearchContext *ctx, int depth, int alpha, int beta, int flags) {
+    ctx->nodes++;
+    COUNT_EVENT(COUNTER_NODES);
+    TRACE_WINDOW(alpha, beta);
+    const int originalAlpha = alpha;
+
+    // A stored result at least as deep answers the node if its bound does.
+    // Leaves are cheaper to evaluate than to store, so only interior nodes
+    // use the table.
+    TranspositionEntry entry;
+    Move hashMove = MOVE_NONE;
+    int found = 0;
+    if (depth > 0) {
+        PROFILE_ENTER(PHASE_HASH);
+        found = probeTransposition(pos->key, &entry);
+        PROFILE_LEAVE();
+        ctx->hashProbes++;
+        COUNT_EVENT(COUNTER_HASH_PROBES);
+    }
+    if (found) {
+        ctx->hashHits++;
+        COUNT_EVENT(COUNTER_HASH_HITS);
+        hashMove = entry.move;
+        int score = scoreFromTransposition(entry.score, ctx->ply);
+        if (entry.depth >= depth &&
+            (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && score >= beta) ||
+             (entry.bound == BOUND_UPPER && score <= alpha))) {
+            ctx->hashCutoffs++;
+            COUNT_EVENT(COUNTER_HASH_CUTOFFS);
+            TRACE_NODE(pos->key, ctx->ply, depth, ctx->line[ctx->ply - 1], traceAlpha, traceBeta, score,
+                       TRACE_HASH, flags, 0, TRACE_NO_CUTOFF);
+            return score;
+        }
+    }
+
+    // Terminal state: depth limit, or no legal moves, which is checkmate in
+    // check and stalemate otherwise. The moves are generated only once.
+    MoveList list;
+    int moveCount = depth > 0 ? generateOrderedMoves(pos, pos->sideToMove, &list) : 0;
+    if (moveCount == 0) {
+        int score;
+        if (depth == 0) {
+            score = evaluateLeaf(pos, ctx->ply);
+        } else {
+            score = isKingInCheck(pos, pos->sideToMove) ? -MATE_SCORE + ctx->ply : 0;
+        }
+        if (depth > 0) {
+            PROFILE_ENTER(PHASE_HASH);
+            storeTransposition(pos->key, MOVE_NONE, depth, BOUND_EXACT, scoreToTransposition(score, ctx->ply));
+            PROFILE_LEAVE();
+        }
+        TRACE_NODE(pos->key, ctx->ply, depth, ctx->line[ctx->ply - 1], traceAlpha, traceBeta, score,
+                   depth == 0 ? TRACE_LEAF : TRACE_TERMINAL, flags, 0, TRACE_NO_CUTOFF);
+        return score;
+    }
+    sortMoves(&list);
+    if (hashMove != MOVE_NONE) {
+        PROFILE_ENTER(PHASE_SORT);
+        promoteMove(&list, hashMove);
+        PROFILE_LEAVE();
+    }
+
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove = MOVE_NONE;
+    int i;
+    for (i = 0; i < moveCount; ++i) {
+        Move m = list.moves[i];
+        int score;
+        if (i == 0) {
+            score = searchMove(pos, ctx, m, depth - 1, alpha, beta, 0);
+        } else {
+            score = searchMove(pos, ctx, m, depth - 1, alpha, alpha + 1, 0);
+            if (score > alpha && score < beta) {
+                score = searchMove(pos, ctx, m, depth - 1, alpha, beta, TRACE_FLAG_RESEARCH);
             }
         }
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = m;
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            COUNT_EVENT(COUNTER_BETA_CUTOFFS);
+            if (i == 0) COUNT_EVENT(COUNTER_FIRST_MOVE_CUTOFFS);
+            break;
+        }
     }
+    // When no move beat alpha there is no best move worth keeping
+    int bound = bestScore <= originalAlpha ? BOUND_UPPER : bestScore >= beta ? BOUND_LOWER : BOUND_EXACT;
+    if (bound == BOUND_UPPER) bestMove = MOVE_NONE;
+    PROFILE_ENTER(PHASE_HASH);
+    storeTransposition(pos->key, bestMove, depth, bound, scoreToTransposition(bestScore, ctx->ply));
+    PROFILE_LEAVE();
+    // The loop stops short of moveCount only on a cutoff
+    TRACE_NODE(pos->key, ctx->ply, depth, ctx->line[ctx->ply - 1], traceAlpha, traceBeta, bestScore,
+               i < moveCount ? TRACE_CUT : bestScore <= traceAlpha ? TRACE_ALL : TRACE_PV, flags, moveCount,
+               i < moveCount ? i : TRACE_NO_CUTOFF);
+    return bestScore;
 }
 
-// Minimax with alpha-beta pruning, depth-limited, using fast move generation
-static int minimax(int depth, int maximizingPlayer, int alpha, int beta) {
-    // Terminal state: checkmate, stalemate, or depth limit
-    if (depth == 0 || isCheckMate(0) || isCheckMate(1) || isStaleMate(0) || isStaleMate(1)) {
-        return evaluateBoard();
-    }
-
-    Move moves[128];
-    int moveCount = generateLegalMoves(maximizingPlayer ? 1 : 0, moves, 128);
-    if (moveCount == 0) return evaluateBoard();
-    sortMoves(moves, moveCount);
-
-    int bestScore = maximizingPlayer ? -10000 : 10000;
-    for (int i = 0; i < moveCount; ++i) {
-        int fr = moves[i].fromRow, fc = moves[i].fromCol, tr = moves[i].toRow, tc = moves[i].toCol;
-        wchar_t savedFrom = board[fr][fc];
-        wchar_t savedTo = board[tr][tc];
-        board[tr][tc] = savedFrom;
-        board[fr][fc] = 0;
-        int score = minimax(depth - 1, !maximizingPlayer, alpha, beta);
-        board[fr][fc] = savedFrom;
-        board[tr][tc] = savedTo;
-        if (maximizingPlayer) {
-            if (score > bestScore) bestScore = score;
-            if (score > alpha) alpha = score;
-            if (beta <= alpha) break;
+// One pass over the root moves with the window alpha..beta, in the same way
+// as negamax. Stops at a move that fails high. Returns the best score and
+// its move's index.
+static int searchRoot(Position *pos, SearchContext *ctx, const MoveList *list, int depth, int alpha, int beta,
+                      int flags, int *bestIdx) {
+    ctx->nodes++;
+    COUNT_EVENT(COUNTER_NODES);
+    TRACE_WINDOW(alpha, beta);
+    int bestScore = -INFINITE_SCORE;
+    int i;
+    *bestIdx = 0;
+    for (i = 0; i < list->count; ++i) {
+        Move m = list->moves[i];
+        int score;
+        if (i == 0) {
+            score = searchMove(pos, ctx, m, depth - 1, alpha, beta, 0);
         } else {
-            if (score < bestScore) bestScore = score;
-            if (score < beta) beta = score;
-            if (beta <= alpha) break;
+            score = searchMove(pos, ctx, m, depth - 1, alpha, alpha + 1, 0);
+            if (score > alpha && score < beta) {
+                score = searchMove(pos, ctx, m, depth - 1, alpha, beta, TRACE_FLAG_RESEARCH);
+            }
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            *bestIdx = i;
         }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
     }
+    TRACE_NODE(pos->key, 0, depth, MOVE_NONE, traceAlpha, traceBeta, bestScore, TRACE_ROOT, flags, list->count,
+               i < list->count ? i : TRACE_NO_CUTOFF);
     return bestScore;
 }
 
-// Iterative deepening wrapper for minimax, optimized for speed
-void getLocalCPUMove(int *fromRow, int *fromCol, int *toRow, int *toCol) {
-    Move moves[128];
-    int bestScore = 10000;
-    int found = 0;
-    int bestIdx = -1;
-    int maxDepth = 3; // Lowered for faster response (increase for stronger play)
-    int moveCount = generateLegalMoves(0, moves, 128);
-    if (moveCount == 0) return;
-    sortMoves(moves, moveCount);
+// Iterative deepening over the root moves of the side to move, keeping the
+// best move of the deepest completed iteration. From ASPIRATION_DEPTH on,
+// each iteration starts with a narrow window around the previous score and
+// widens the side that fails until the score falls inside.
+void searchPosition(const Position *pos, int maxDepth, SearchResult *result) {
+    // Search on a private copy so the caller's position and game record are untouched
+    Position search = *pos;
+    search.record = NULL;
+    SearchContext ctx = {{0}, 0, 0, {0}, 0, 0, 0};
+    MoveList list;
+
+    result->bestMove = MOVE_NONE;
+    result->score = 0;
+    result->nodes = 0;
+    PROFILE_BEGIN_SEARCH();
+    TRACE_BEGIN_SEARCH();
+    ageTranspositionTable();
+    int moveCount = generateOrderedMoves(&search, search.sideToMove, &list);
+    if (moveCount == 0) {
+        PROFILE_END_SEARCH();
+        return;
+    }
+    sortMoves(&list);
+
+    // Seed the search's key stack with the game positions a repetition could
+    // still reach: those since the last pawn move or capture
+    const HashHistory *played = pos->record ? &pos->record->positions : NULL;
+    if (played && played->count > 0) {
+        int first = played->count - 1 - pos->fiftyMoveCounter;
+        for (int i = first < 0 ? 0 : first; i < played->count; ++i) {
+            pushPositionKey(&ctx.history, played->keys[i]);
+        }
+    } else {
+        pushPositionKey(&ctx.history, search.key);
+    }
 
-    // Search at increasing depth, always keep best move found so far
+    // Search at increasing depth. The best move so far is kept first in the
+    // list (the first legal move before any iteration), so every pass starts
+    // from it.
+    if (maxDepth > MAX_SEARCH_PLY) maxDepth = MAX_SEARCH_PLY;
+    int score = 0;
     for (int depth = 1; depth <= maxDepth; ++depth) {
-        found = 0;
-        bestScore = 10000;
-        for (int i = 0; i < moveCount; ++i) {
-            int fr = moves[i].fromRow, fc = moves[i].fromCol, tr = moves[i].toRow, tc = moves[i].toCol;
-            wchar_t savedFrom = board[fr][fc];
-            wchar_t savedTo = board[tr][tc];
-            board[tr][tc] = savedFrom;
-            board[fr][fc] = 0;
-            int score = minimax(depth - 1, 1, -10000, 10000);
-            board[fr][fc] = savedFrom;
-            board[tr][tc] = savedTo;
-            if (!found || score < bestScore) {
-                bestScore = score;
-                bestIdx = i;
-                found = 1;
+        int delta = ASPIRATION_WINDOW;
+        int alpha = -INFINITE_SCORE, beta = INFINITE_SCORE;
+        if (depth >= ASPIRATION_DEPTH && score > -MATE_BOUND && score < MATE_BOUND) {
+            alpha = score - delta;
+            beta = score + delta;
+        }
+        int flags = 0;
+        for (;;) {
+            int bestIdx;
+            score = searchRoot(&search, &ctx, &list, depth, alpha, beta, flags, &bestIdx);
+            // A move that failed high is the best so far; after a fail low
+            // no move is known to be better than the previous best
+            if (score > alpha) promoteMove(&list, list.moves[bestIdx]);
+            if (score <= alpha) {
+                alpha = score - delta > -INFINITE_SCORE ? score - delta : -INFINITE_SCORE;
+            } else if (score >= beta) {
+                beta = score + delta < INFINITE_SCORE ? score + delta : INFINITE_SCORE;
+            } else {
+                break;
             }
+            delta *= 2;
+            flags = TRACE_FLAG_RESEARCH;
         }
-        if (!found) break;
-    }
-    if (found && bestIdx >= 0) {
-        *fromRow = moves[bestIdx].fromRow;
-        *fromCol = moves[bestIdx].fromCol;
-        *toRow = moves[bestIdx].toRow;
-        *toCol = moves[bestIdx].toCol;
-        return;
     }
-    // Fallback: pick first legal move
-    *fromRow = moves[0].fromRow;
-    *fromCol = moves[0].fromCol;
-    *toRow = moves[0].toRow;
-    *toCol = moves[0].toCol;
+    free(ctx.history.keys);
+    addTranspositionCounts(ctx.hashProbes, ctx.hashHits, ctx.hashCutoffs);
+    result->bestMove = list.moves[0];
+    result->score = search.sideToMove ? score : -score;
+    result->nodes = ctx.nodes;
+    PROFILE_END_SEARCH();
 }
 
+// The local CPU always plays black. Returns the move searched, promotion
+// piece included, or MOVE_NONE if black has no legal move.
+Move getLocalCPUMove(const Position *pos) {
+    Position black = *pos;
+    SearchResult result;
+    CounterSnapshot before;
+    int maxDepth = 3; // Lowered for faster response (increase for stronger play)
+
+    if (black.sideToMove) {
+        black.sideToMove = 0;
+        black.key ^= ZOBRIST_SIDE;
+    }
+    snapshotCounters(&before);
+    searchPosition(&black, maxDepth, &result);
+    dumpCounters("getLocalCPUMove", &before);
+    PROFILE_DUMP("getLocalCPUMove");
+    return result.bestMove;
+}
@@ -0,0 +1,479 @@
+// Move generator perft: counts the leaf nodes of the legal move tree to a
+// fixed depth, so generateLegalMoves and make/unmake can be checked against
+// published node counts and timed.
+//
+// Usage: c_chess_perft [options] <depth> [FEN]   divide counts and total
+//        c_chess_perft [options] suite           built-in reference positions
+//        c_chess_perft [options] scaling <depth> [FEN]
+//                                                speedup per thread count, up to
+//                                                -t threads (default every core)
+// Options: -t <threads>   -H <hash MB>   --no-bulk
+//
+// By default the last ply is bulk counted: the legal move count is returned
+// without making the moves. -H adds a table of subtree counts keyed by
+// Zobrist key and depth, so transpositions are counted once. --no-bulk and
+// leaving out -H give the plain recursion to compare the totals against.
+//
+// With more than one thread (-t 0 uses every core) the tree is split a ply or
+// two below the root into independent subtrees that the threads pull from a
+// shared atomic index. Each thread searches on its own Position, so this also
+// checks that move generation keeps no shared mutable state.
+//
+// This stands in for a work-stealing pool. Perft subtrees never spawn work
+// while they run, so splitting until there are 16 subtrees per thread, and
+// letting idle threads claim the next one, balances the load as well as
+// stealing would, with one atomic increment per subtree and no deques.
+// "scaling" reports the measured efficiency per thread count.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "chess.h"
+#include "movegen.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// Reference positions with known node counts
+typedef struct {
+    const char *name;
+    const char *fen;
+    int depth;
+    unsigned long long nodes;
+} PerftCase;
+
+static const PerftCase perftSuite[] = {
+    {"startpos", START_FEN, 6, 119060324ULL},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690ULL},
+    {"en passant endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624ULL},
+    {"promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333ULL},
+    {"discovered promotion", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487ULL},
+    {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551ULL},
+    {"illegal en passant, pinned", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888ULL},
+    {"en passant gives check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467ULL},
+    {"short castle gives check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072ULL},
+    {"long castle gives check", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711ULL},
+    {"castling rights", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206ULL},
+    {"castling prevented", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476ULL},
+    {"promote out of check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001ULL},
+    {"discovered check", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658ULL},
+    {"underpromote to check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342ULL},
+    {"self stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217ULL},
+    {"stalemate and checkmate", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584ULL},
+};
+
+// Wall-clock seconds
+static double now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// --- Perft transposition table ---
+
+// Counts are packed with the depth as nodes << 8 | depth and stored next to
+// key ^ data. Threads read and write entries without locks; a torn entry
+// fails the key check and is treated as a miss.
+typedef struct {
+    _Atomic uint64_t check;
+    _Atomic uint64_t data;
+} PerftEntry;
+
+static PerftEntry *perftHash;
+static uint64_t perftHashMask;
+static int bulkCounting = 1;
+
+static int allocatePerftHash(size_t megabytes) {
+    size_t entries = 1;
+    while (entries * 2 * sizeof(PerftEntry) <= megabytes * 1024 * 1024) entries *= 2;
+    perftHash = calloc(entries, sizeof(PerftEntry));
+    if (!perftHash) return 0;
+    perftHashMask = entries - 1;
+    return 1;
+}
+
+static void clearPerftHash() {
+    if (perftHash) memset(perftHash, 0, (size_t)(perftHashMask + 1) * sizeof(PerftEntry));
+}
+
+// The same position is stored once per depth, in different slots
+static PerftEntry *perftSlot(uint64_t key, int depth) {
+    return &perftHash[(key ^ (uint64_t)depth * 0x9E3779B97F4A7C15ULL) & perftHashMask];
+}
+
+static int probePerftHash(uint64_t key, int depth, unsigned long long *nodes) {
+    PerftEntry *entry = perftSlot(key, depth);
+    uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+    if ((check ^ data) != key || (int)(data & 0xFF) != depth) return 0;
+    *nodes = data >> 8;
+    return 1;
+}
+
+static void storePerftHash(uint64_t key, int depth, unsigned long long nodes) {
+    PerftEntry *entry = perftSlot(key, depth);
+    uint64_t data = (uint64_t)nodes << 8 | (uint64_t)depth;
+    atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+}
+
+static unsigned long long perft(Position *pos, int depth) {
+    MoveList list;
+    unsigned long long nodes = 0;
+
+    if (depth == 0) return 1;
+    if (perftHash && depth > 1 && probePerftHash(pos->key, depth, &nodes)) {
+        return nodes;
+    }
+
+    generateLegalMoves(pos, pos->sideToMove, &list);
+    if (depth == 1 && bulkCounting) {
+        return (unsigned long long)list.count;
+    }
+    for (int i = 0; i < list.count; ++i) {
+        Undo undo;
+        makeMove(pos, list.moves[i], &undo);
+        nodes += perft(pos, depth - 1);
+        unmakeMove(pos, list.moves[i], &undo);
+    }
+
+    if (perftHash && depth > 1) {
+        storePerftHash(pos->key, depth, nodes);
+    }
+    return nodes;
+}
+
+// Number of online processors, at least 1
+static int cpuCount() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// --- Parallel perft ---
+
+// Deepest split below the root; keeps work items small and frontier cheap
+#define MAX_SPLIT_PLIES 3
+
+// An independent subtree: the moves leading to it from the root position
+typedef struct {
+    Move path[MAX_SPLIT_PLIES];
+    int plies;
+    int root;                       // index of the root move it descends from
+    unsigned long long nodes;       // written only by the thread that took it
+} PerftWork;
+
+typedef struct {
+    const Position *root;
+    PerftWork *items;
+    int count;
+    int depth;                      // plies left to count below each item
+    atomic_int next;                // next unclaimed item
+} PerftQueue;
+
+static void replayPath(Position *pos, const PerftWork *item) {
+    for (int i = 0; i < item->plies; ++i) {
+        Undo undo;
+        makeMove(pos, item->path[i], &undo);
+    }
+}
+
+static void *perftWorker(void *arg) {
+    PerftQueue *queue = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&queue->next, 1);
+        if (i >= queue->count) break;
+        Position pos = *queue->root;
+        replayPath(&pos, &queue->items[i]);
+        queue->items[i].nodes = perft(&pos, queue->depth);
+    }
+    return NULL;
+}
+
+// Replace every item by one per legal move below it
+static PerftWork *expandFrontier(const Position *root, PerftWork *items, int *count) {
+    int capacity = *count * 8 + MAX_MOVES, expanded = 0;
+    PerftWork *next = malloc((size_t)capacity * sizeof(PerftWork));
+    if (!next) return NULL;
+
+    for (int i = 0; i < *count; ++i) {
+        Position pos = *root;
+        MoveList list;
+        replayPath(&pos, &items[i]);
+        generateLegalMoves(&pos, pos.sideToMove, &list);
+        for (int j = 0; j < list.count; ++j) {
+            if (expanded == capacity) {
+                capacity *= 2;
+                PerftWork *grown = realloc(next, (size_t)capacity * sizeof(PerftWork));
+                if (!grown) {
+                    free(next);
+                    return NULL;
+                }
+                next = grown;
+            }
+            next[expanded] = items[i];
+            next[expanded].path[next[expanded].plies++] = list.moves[j];
+            expanded++;
+        }
+    }
+    free(items);
+    *count = expanded;
+    return next;
+}
+
+// Perft split over threads. rootMoves receives the legal root moves and
+// rootNodes (if not NULL) the node count below each. Returns the total, or
+// 0 with an error message if the work could not be set up.
+static unsigned long long parallelPerft(const Position *pos, int depth, int threads,
+                                        MoveList *rootMoves, unsigned long long *rootNodes) {
+    PerftQueue queue;
+    unsigned long long total = 0;
+
+    generateLegalMoves(pos, pos->sideToMove, rootMoves);
+    queue.root = pos;
+    queue.count = rootMoves->count;
+    queue.items = malloc((size_t)(queue.count ? queue.count : 1) * sizeof(PerftWork));
+    if (!queue.items) {
+        fprintf(stderr, "Error: Could not allocate perft work\n");
+        return 0;
+    }
+    for (int i = 0; i < queue.count; ++i) {
+        queue.items[i].path[0] = rootMoves->moves[i];
+        queue.items[i].plies = 1;
+        queue.items[i].root = i;
+    }
+
+    // Split deeper until there are enough subtrees to balance the threads,
+    // always leaving at least one ply to count in each
+    queue.depth = depth - 1;
+    for (int plies = 1; plies < MAX_SPLIT_PLIES && queue.depth > 1 && queue.count < threads * 16; ++plies) {
+        queue.items = expandFrontier(pos, queue.items, &queue.count);
+        if (!queue.items) {
+            fprintf(stderr, "Error: Could not allocate perft work\n");
+            return 0;
+        }
+        queue.depth--;
+    }
+    atomic_init(&queue.next, 0);
+
+    pthread_t *workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers) {
+        free(queue.items);
+        fprintf(stderr, "Error: Could not allocate perft threads\n");
+        return 0;
+    }
+    int started = 0;
+    for (; started < threads; ++started) {
+        if (pthread_create(&workers[started], NULL, perftWorker, &queue) != 0) break;
+    }
+    if (started == 0) {
+        perftWorker(&queue);     // no threads available: count on this one
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    if (rootNodes) {
+        memset(rootNodes, 0, (size_t)rootMoves->count * sizeof(*rootNodes));
+    }
+    for (int i = 0; i < queue.count; ++i) {
+        total += queue.items[i].nodes;
+        if (rootNodes) rootNodes[queue.items[i].root] += queue.items[i].nodes;
+    }
+    free(queue.items);
+    return total;
+}
+
+// Total node count with the given number of threads
+static unsigned long long countNodes(Position *pos, int depth, int threads) {
+    MoveList rootMoves;
+    if (threads <= 1 || depth <= 1) {
+        return perft(pos, depth);
+    }
+    return parallelPerft(pos, depth, threads, &rootMoves, NULL);
+}
+
+// Coordinate notation (e2e4, e7e8q) as used by perft tools
+static void formatCoordinates(Move m, int whiteMove, char out[6]) {
+    static const char promotionLetters[13] = {0, 0, 'q', 'r', 'b', 'n', 0, 0, 'q', 'r', 'b', 'n', 0};
+    int from = MOVE_FROM(m), to = MOVE_TO(m);
+    sprintf(out, "%c%d%c%d", 'a' + SQUARE_COL(from), SQUARE_ROW(from) + 1,
+            'a' + SQUARE_COL(to), SQUARE_ROW(to) + 1);
+    if (MOVE_IS_PROMOTION(m)) {
+        out[4] = promotionLetters[movePromotionPiece(m, whiteMove)];
+        out[5] = '\0';
+    }
+}
+
+// Perft of every root move, then the total
+static unsigned long long divide(Position *pos, int depth, int threads) {
+    MoveList list;
+    unsigned long long rootNodes[MAX_MOVES];
+    unsigned long long total = 0;
+
+    if (threads > 1 && depth > 1) {
+        total = parallelPerft(pos, depth, threads, &list, rootNodes);
+    } else {
+        generateLegalMoves(pos, pos->sideToMove, &list);
+        for (int i = 0; i < list.count; ++i) {
+            Undo undo;
+            makeMove(pos, list.moves[i], &undo);
+            rootNodes[i] = perft(pos, depth - 1);
+            unmakeMove(pos, list.moves[i], &undo);
+            total += rootNodes[i];
+        }
+    }
+    for (int i = 0; i < list.count; ++i) {
+        char text[6];
+        formatCoordinates(list.moves[i], pos->sideToMove, text);
+        printf("%s: %llu\n", text, rootNodes[i]);
+    }
+    return total;
+}
+
+static void printRate(unsigned long long nodes, double seconds) {
+    printf("Time: %.3f s\n", seconds);
+    printf("Nodes/sec: %.0f\n", seconds > 0 ? (double)nodes / seconds : 0.0);
+}
+
+static int runSuite(int threads) {
+    int failures = 0;
+    unsigned long long totalNodes = 0;
+    double totalSeconds = 0;
+    int count = (int)(sizeof(perftSuite) / sizeof(perftSuite[0]));
+
+    for (int i = 0; i < count; ++i) {
+        const PerftCase *test = &perftSuite[i];
+        Position pos;
+        if (!setPositionFromFen(&pos, test->fen)) {
+            printf("Error: Could not parse FEN for %s\n", test->name);
+            failures++;
+            continue;
+        }
+        clearPerftHash();
+        double start = now();
+        unsigned long long nodes = countNodes(&pos, test->depth, threads);
+        double seconds = now() - start;
+        int ok = nodes == test->nodes;
+        printf("%-28s depth %d  %12llu  %s  %.3f s\n", test->name, test->depth, nodes,
+               ok ? "OK  " : "FAIL", seconds);
+        if (!ok) {
+            printf("    expected %llu\n", test->nodes);
+            failures++;
+        }
+        totalNodes += nodes;
+        totalSeconds += seconds;
+    }
+
+    printf("\nThreads: %d, bulk counting %s, hash %s\n", threads, bulkCounting ? "on" : "off",
+           perftHash ? "on" : "off");
+    printf("Nodes: %llu\n", totalNodes);
+    printRate(totalNodes, totalSeconds);
+    printf("%d of %d positions passed\n", count - failures, count);
+    return failures ? 1 : 0;
+}
+
+// Time the same count at 1, 2, 4, ... threads up to maxThreads and report
+// speedup and efficiency against the single-threaded run
+static int runScaling(Position *pos, int depth, int maxThreads) {
+    double baseline = 0;
+    unsigned long long expected = 0;
+
+    printf("%7s %14s %10s %14s %8s %10s\n", "threads", "nodes", "time (s)", "nodes/sec", "speedup", "efficiency");
+    for (int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads) {
+        clearPerftHash();
+        double start = now();
+        unsigned long long nodes = countNodes(pos, depth, threads);
+        double seconds = now() - start;
+        if (threads == 1) {
+            baseline = seconds;
+            expected = nodes;
+        } else if (nodes != expected) {
+            printf("Error: %d threads counted %llu nodes, 1 thread counted %llu\n", threads, nodes, expected);
+            return 1;
+        }
+        double speedup = seconds > 0 ? baseline / seconds : 0.0;
+        printf("%7d %14llu %10.3f %14.0f %7.2fx %9.1f%%\n", threads, nodes, seconds,
+               seconds > 0 ? (double)nodes / seconds : 0.0, speedup, 100.0 * speedup / threads);
+        if (threads == maxThreads) break;
+    }
+    return 0;
+}
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "Usage: %s [options] <depth> [FEN]\n"
+                    "       %s [options] suite\n"
+                    "       %s [options] scaling <depth> [FEN]\n"
+                    "Options:\n"
+                    "  -t <threads>  split the count over threads, 0 = every core; for scaling,\n"
+                    "                the most threads to time (default every core)\n"
+                    "  -H <MB>       cache subtree counts in a hash table of this size\n"
+                    "  --no-bulk     make every last-ply move instead of counting them\n",
+            program, program, program);
+}
+
+int main(int argc, char **argv) {
+    int threads = 1;
+    int threadsGiven = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) {
+            threads = atoi(argv[++arg]);
+            if (threads <= 0) threads = cpuCount();
+            threadsGiven = 1;
+        } else if (strcmp(argv[arg], "-H") == 0 && arg + 1 < argc) {
+            int megabytes = atoi(argv[++arg]);
+            if (megabytes < 1 || !allocatePerftHash((size_t)megabytes)) {
+                fprintf(stderr, "Error: Could not allocate a %s MB perft hash\n", argv[arg]);
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "--no-bulk") == 0) {
+            bulkCounting = 0;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (arg < argc && strcmp(argv[arg], "suite") == 0 && arg + 1 == argc) {
+        return runSuite(threads);
+    }
+
+    int scaling = arg < argc && strcmp(argv[arg], "scaling") == 0;
+    if (scaling) arg++;
+    if (arg >= argc || argc - arg > 2 || atoi(argv[arg]) < 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int depth = atoi(argv[arg]);
+    const char *fen = arg + 1 < argc ? argv[arg + 1] : START_FEN;
+    Position pos;
+    if (!setPositionFromFen(&pos, fen)) {
+        fprintf(stderr, "Error: Could not parse FEN \"%s\"\n", fen);
+        return 1;
+    }
+    if (scaling) {
+        return runScaling(&pos, depth, threadsGiven ? threads : cpuCount());
+    }
+
+    double start = now();
+    unsigned long long nodes = divide(&pos, depth, threads);
+    double seconds = now() - start;
+    printf("\nNodes: %llu\n", nodes);
+    printRate(nodes, seconds);
+    return 0;
+}
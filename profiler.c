@@ -0,0 +1,122 @@
+#include "profiler.h"
+
+#ifdef CHESS_PROFILE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "chess.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define TICK_UNIT "cycles"
+static inline uint64_t readTicks() { return __rdtsc(); }
+#else
+#define TICK_UNIT "ns"
+static inline uint64_t readTicks() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define MAX_PHASE_DEPTH 16
+
+static const char *phaseNames[PHASE_COUNT] = {
+    "search", "movegen", "make/unmake", "status", "evaluation", "sort", "hash",
+};
+
+typedef struct {
+    uint64_t ticks[PHASE_COUNT];
+    uint64_t calls[PHASE_COUNT];
+} ProfileTotals;
+
+// Each thread profiles its own searches
+typedef struct {
+    ProfilePhase stack[MAX_PHASE_DEPTH];
+    int depth;
+    uint64_t last;              // tick of the last phase change
+    ProfileTotals search;
+    ProfileTotals game;
+} Profiler;
+
+static CHESS_THREAD_LOCAL Profiler profiler;
+
+// Charge the ticks since the last phase change to the open phase
+static inline uint64_t chargeOpenPhase() {
+    uint64_t now = readTicks();
+    if (profiler.depth > 0) {
+        profiler.search.ticks[profiler.stack[profiler.depth - 1]] += now - profiler.last;
+    }
+    profiler.last = now;
+    return now;
+}
+
+void profileEnter(ProfilePhase phase) {
+    chargeOpenPhase();
+    if (profiler.depth < MAX_PHASE_DEPTH) {
+        profiler.stack[profiler.depth++] = phase;
+        profiler.search.calls[phase]++;
+    }
+}
+
+void profileLeave() {
+    chargeOpenPhase();
+    if (profiler.depth > 0) profiler.depth--;
+}
+
+void profileBeginSearch() {
+    memset(&profiler.search, 0, sizeof(profiler.search));
+    profiler.depth = 0;
+    profileEnter(PHASE_SEARCH);
+}
+
+void profileEndSearch() {
+    profileLeave();
+    profiler.depth = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        profiler.game.ticks[i] += profiler.search.ticks[i];
+        profiler.game.calls[i] += profiler.search.calls[i];
+    }
+}
+
+void profileResetGame() {
+    memset(&profiler.game, 0, sizeof(profiler.game));
+}
+
+static uint64_t totalTicks(const ProfileTotals *totals) {
+    uint64_t total = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i) total += totals->ticks[i];
+    return total;
+}
+
+void dumpProfile(const char *label) {
+    const char *filename = getenv("CHESS_PROFILE_FILE");
+    FILE *out = filename ? fopen(filename, "a") : stderr;
+    if (!out) {
+        fprintf(stderr, "Error: Could not open %s for the profile\n", filename);
+        return;
+    }
+
+    uint64_t searchTotal = totalTicks(&profiler.search);
+    uint64_t gameTotal = totalTicks(&profiler.game);
+    fprintf(out, "Profile: %s (%s)\n", label, TICK_UNIT);
+    fprintf(out, "%-12s %12s %16s %7s %16s %7s\n", "phase", "calls", "search", "%", "game", "%");
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        fprintf(out, "%-12s %12llu %16llu %6.1f%% %16llu %6.1f%%\n", phaseNames[i],
+                (unsigned long long)profiler.search.calls[i],
+                (unsigned long long)profiler.search.ticks[i],
+                searchTotal ? 100.0 * (double)profiler.search.ticks[i] / (double)searchTotal : 0.0,
+                (unsigned long long)profiler.game.ticks[i],
+                gameTotal ? 100.0 * (double)profiler.game.ticks[i] / (double)gameTotal : 0.0);
+    }
+    fprintf(out, "%-12s %12s %16llu %7s %16llu\n\n", "total", "",
+            (unsigned long long)searchTotal, "", (unsigned long long)gameTotal);
+    if (out != stderr) fclose(out);
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef C_CHESS_PROFILER_H
+#define C_CHESS_PROFILER_H
+
+// Per-phase search profiler. Built in only with CHESS_PROFILE defined (CMake
+// option of the same name); otherwise every PROFILE_* macro compiles to
+// nothing.
+//
+// Time is read from the time-stamp counter (nanoseconds where there is none)
+// at every phase change and charged to the innermost open phase, so the
+// breakdown is flat: a status check inside evaluation counts as status only.
+// Time in no instrumented phase is charged to the search itself.
+typedef enum {
+    PHASE_SEARCH,           // search bookkeeping outside the phases below
+    PHASE_MOVEGEN,          // legal move generation and ordering scores
+    PHASE_MAKE_UNMAKE,
+    PHASE_STATUS,           // check, mate and stalemate detection
+    PHASE_EVALUATION,
+    PHASE_SORT,             // move ordering
+    PHASE_HASH,             // key history, repetition and transposition table probes
+    PHASE_COUNT
+} ProfilePhase;
+
+#ifdef CHESS_PROFILE
+void profileEnter(ProfilePhase phase);
+void profileLeave();
+void profileBeginSearch();
+void profileEndSearch();
+void profileResetGame();
+void dumpProfile(const char *label);
+
+#define PROFILE_ENTER(phase) profileEnter(phase)
+#define PROFILE_LEAVE() profileLeave()
+#define PROFILE_BEGIN_SEARCH() profileBeginSearch()
+#define PROFILE_END_SEARCH() profileEndSearch()
+#define PROFILE_RESET_GAME() profileResetGame()
+// Flat breakdown of the last search and of the game so far, appended to the
+// file named by CHESS_PROFILE_FILE or written to stderr
+#define PROFILE_DUMP(label) dumpProfile(label)
+#else
+#define PROFILE_ENTER(phase) ((void)0)
+#define PROFILE_LEAVE() ((void)0)
+#define PROFILE_BEGIN_SEARCH() ((void)0)
+#define PROFILE_END_SEARCH() ((void)0)
+#define PROFILE_RESET_GAME() ((void)0)
+#define PROFILE_DUMP(label) ((void)0)
+#endif
+
+#endif //C_CHESS_PROFILER_H
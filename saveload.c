@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "chess.h"
+#include "movegen.h"
 
 // Save the game in PGN format
 int saveGame(const char* filename) {
@@ -22,27 +23,21 @@ int saveGame(const char* filename) {
     fprintf(file, "[Result \"*\"]\n");
     fprintf(file, "\n");
 
-    // Write move history as PGN main line with move numbers and line breaks every 10 moves
-    int moveNum = 1;
-    char copy[4096];
-    strcpy(copy, moveHistory);
-    char* token = strtok(copy, " ");
-    int isWhite = 1;
+    // Write move history as PGN main line with move numbers and line breaks every 10 moves,
+    // using the text the game record keeps for each move
     int movesOnLine = 0;
-    while (token) {
-        if (isWhite) {
-            fprintf(file, "%d. %s ", moveNum, token);
+    for (int i = 0; i < gameRecord.moveCount; ++i) {
+        const char *text = gameRecord.moveTexts[i];
+        if (i % 2 == 0) {
+            fprintf(file, "%d. %s ", i / 2 + 1, text);
         } else {
-            fprintf(file, "%s ", token);
-            moveNum++;
+            fprintf(file, "%s ", text);
         }
-        isWhite = !isWhite;
         movesOnLine++;
         if (movesOnLine >= 10) {
             fprintf(file, "\n");
             movesOnLine = 0;
         }
-        token = strtok(NULL, " ");
     }
     // Write result marker at the end
     fprintf(file, "*\n");
@@ -59,7 +54,7 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
         // White or black: find king and rook
         for (int row = 0; row < 8; ++row) {
             for (int col = 4; col <= 4; ++col) {
-                wchar_t piece = board[row][col];
+                wchar_t piece = getBoardPiece(row, col);
                 if (piece == white_king && row == 0) {
                     *fromRow = 0; *fromCol = 4; *toRow = 0; *toCol = 6;
                     return 1;
@@ -75,7 +70,7 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
         // Queenside castling
         for (int row = 0; row < 8; ++row) {
             for (int col = 4; col <= 4; ++col) {
-                wchar_t piece = board[row][col];
+                wchar_t piece = getBoardPiece(row, col);
                 if (piece == white_king && row == 0) {
                     *fromRow = 0; *fromCol = 4; *toRow = 0; *toCol = 2;
                     return 1;
@@ -100,6 +95,15 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
     int len = strlen(move);
     while (len > 0 && (move[len-1] == '!' || move[len-1] == '?')) move[--len] = 0;
 
+    // Coordinate notation as saveGame writes it ("e2e4", "Ng1f3", "Ke1g1")
+    const char *squares = move[0] >= 'A' && move[0] <= 'Z' ? move + 1 : move;
+    if (strlen(squares) == 4 && squares[0] >= 'a' && squares[0] <= 'h' && squares[1] >= '1' && squares[1] <= '8' &&
+        squares[2] >= 'a' && squares[2] <= 'h' && squares[3] >= '1' && squares[3] <= '8') {
+        *fromCol = squares[0] - 'a'; *fromRow = squares[1] - '1';
+        *toCol = squares[2] - 'a'; *toRow = squares[3] - '1';
+        return isValidMove(&gamePosition, *fromRow, *fromCol, *toRow, *toCol);
+    }
+
     // Handle pawn moves like "e4", "exd5"
     if ((len == 2 && move[0] >= 'a' && move[0] <= 'h' && move[1] >= '1' && move[1] <= '8') ||
         (len >= 4 && move[1] == 'x')) {
@@ -108,9 +112,9 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
         // Find pawn that can move to dest
         for (int row = 0; row < 8; ++row) {
             for (int col = 0; col < 8; ++col) {
-                wchar_t piece = board[row][col];
+                wchar_t piece = getBoardPiece(row, col);
                 if (piece == white_pawn || piece == black_pawn) {
-                    if (isValidMove(row, col, destRow, destCol)) {
+                    if (isValidMove(&gamePosition, row, col, destRow, destCol)) {
                         *fromRow = row; *fromCol = col; *toRow = destRow; *toCol = destCol;
                         return 1;
                     }
@@ -147,7 +151,7 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
     // Find matching piece
     for (int row = 0; row < 8; ++row) {
         for (int col = 0; col < 8; ++col) {
-            wchar_t piece = board[row][col];
+            wchar_t piece = getBoardPiece(row, col);
             if (pieceChar) {
                 if ((pieceChar == 'N' && (piece == white_knight || piece == black_knight)) ||
                     (pieceChar == 'B' && (piece == white_bishop || piece == black_bishop)) ||
@@ -155,7 +159,7 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
                     (pieceChar == 'Q' && (piece == white_queen || piece == black_queen)) ||
                     (pieceChar == 'K' && (piece == white_king || piece == black_king))) {
                     if ((srcCol == -1 || col == srcCol) && (srcRow == -1 || row == srcRow)) {
-                        if (isValidMove(row, col, destRow, destCol)) {
+                        if (isValidMove(&gamePosition, row, col, destRow, destCol)) {
                             *fromRow = row; *fromCol = col; *toRow = destRow; *toCol = destCol;
                             return 1;
                         }
@@ -167,14 +171,14 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
     // Fallback: try all pieces for this destination
     for (int row = 0; row < 8; ++row) {
         for (int col = 0; col < 8; ++col) {
-            wchar_t piece = board[row][col];
+            wchar_t piece = getBoardPiece(row, col);
             if (!pieceChar || (pieceChar == 'N' && (piece == white_knight || piece == black_knight)) ||
                 (pieceChar == 'B' && (piece == white_bishop || piece == black_bishop)) ||
                 (pieceChar == 'R' && (piece == white_rook || piece == black_rook)) ||
                 (pieceChar == 'Q' && (piece == white_queen || piece == black_queen)) ||
                 (pieceChar == 'K' && (piece == white_king || piece == black_king))) {
                 if ((srcCol == -1 || col == srcCol) && (srcRow == -1 || row == srcRow)) {
-                    if (isValidMove(row, col, destRow, destCol)) {
+                    if (isValidMove(&gamePosition, row, col, destRow, destCol)) {
                         *fromRow = row; *fromCol = col; *toRow = destRow; *toCol = destCol;
                         return 1;
                     }
@@ -185,80 +189,79 @@ static int sanToCoords(const char *san, int *fromRow, int *fromCol, int *toRow,
     return 0;
 }
 
-// Helper: Reset board and replay moves from moveHistory or PGN SAN moves
-static void replayMoves(const char* moves) {
-    createBoard();
-    // Reset all state variables
-    moveHistory[0] = '\0';
-    whiteKingMoved = whiteKingRookMoved = whiteQueenRookMoved = 0;
-    blackKingMoved = blackKingRookMoved = blackQueenRookMoved = 0;
-    enPassantTargetRow = enPassantTargetCol = -1;
-    fiftyMoveCounter = 0;
-    repetitionCount = 0;
-
-    char copy[4096];
-    strncpy(copy, moves, sizeof(copy)-1);
-    copy[sizeof(copy)-1] = '\0';
-    char* token = strtok(copy, " \t\r\n");
-    while (token) {
-        // Skip move numbers and results
-        if (isdigit(token[0]) && (strchr(token, '.') || strlen(token) <= 3)) {
-            token = strtok(NULL, " \t\r\n");
-            continue;
-        }
-        if (strcmp(token, "1-0") == 0 || strcmp(token, "0-1") == 0 || strcmp(token, "1/2-1/2") == 0 || strcmp(token, "*") == 0) {
-            break;
-        }
-        // Skip comments and empty tokens
-        if (token[0] == '{' || token[0] == '(' || token[0] == '[') {
-            token = strtok(NULL, " \t\r\n");
-            continue;
-        }
-        // Try to parse SAN move
-        int fromRow, fromCol, toRow, toCol;
-        if (sanToCoords(token, &fromRow, &fromCol, &toRow, &toCol)) {
-            executeMove(fromRow, fromCol, toRow, toCol);
+// Helper: play one token of PGN move text on the game position. Returns 0
+// at the result marker that ends the game.
+static int replayToken(const char *token) {
+    if (strcmp(token, "1-0") == 0 || strcmp(token, "0-1") == 0 || strcmp(token, "1/2-1/2") == 0 || strcmp(token, "*") == 0) {
+        return 0;
+    }
+    // Skip move numbers
+    if (isdigit((unsigned char)token[0]) && (strchr(token, '.') || strlen(token) <= 3)) {
+        return 1;
+    }
+    // Try to parse SAN move, keeping an underpromotion ("e8=N")
+    int fromRow, fromCol, toRow, toCol;
+    if (sanToCoords(token, &fromRow, &fromCol, &toRow, &toCol)) {
+        int from = SQUARE(fromRow, fromCol), to = SQUARE(toRow, toCol);
+        Move m = moveFromSquares(&gamePosition, from, to);
+        const char *promotion = strchr(token, '=');
+        const char *pieces = "NBRQ";
+        if (MOVE_IS_PROMOTION(m) && promotion && promotion[1] && strchr(pieces, promotion[1])) {
+            m = ENCODE_MOVE(from, to, (MOVE_KIND(m) & ~3) | (int)(strchr(pieces, promotion[1]) - pieces));
         }
-        token = strtok(NULL, " \t\r\n");
+        playMove(&gamePosition, m);
     }
+    return 1;
 }
 
+// Reads the move text a character at a time, so a game of any length loads:
+// header lines and {...} or (...) comments are skipped, every other run of
+// non-blank characters is replayed as a token
 int loadGame(const char* filename) {
     FILE* file = fopen(filename, "r");
     if (!file) {
         printf("Error: Could not open PGN file %s\n", filename);
         return 0;
     }
-    char line[4096];
-    char moves[4096] = "";
-    // Skip headers and collect move text
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '[') continue;
-        // Remove comments in curly braces or parentheses
-        char *p = line;
-        while (*p) {
-            if (*p == '{' || *p == '(') {
-                while (*p && *p != '}' && *p != ')') ++p;
-                if (*p) ++p;
-            } else {
-                strncat(moves, p, 1);
-                ++p;
+
+    // Resets the position, castling/en passant state and the game record
+    createBoard();
+
+    char token[64];
+    size_t length = 0;
+    int lineStart = 1;
+    int ended = 0;
+    int c;
+    while (!ended && (c = fgetc(file)) != EOF) {
+        int separator = isspace(c);
+        if (lineStart && c == '[') {
+            while ((c = fgetc(file)) != EOF && c != '\n') {
             }
+            separator = 1;
+        } else if (c == '{' || c == '(') {
+            int close = c == '{' ? '}' : ')';
+            while ((c = fgetc(file)) != EOF && c != close) {
+            }
+            separator = 1;
         }
-    }
-    fclose(file);
+        lineStart = c == '\n';
 
-    // Remove newlines and extra whitespace
-    char cleanMoves[4096] = "";
-    int j = 0;
-    for (int i = 0; moves[i]; ++i) {
-        if (moves[i] == '\n' || moves[i] == '\r') continue;
-        cleanMoves[j++] = moves[i];
+        if (!separator) {
+            // Longer runs are no moves; keep the start so they still fail to parse
+            if (length < sizeof(token) - 1) token[length++] = (char)c;
+            continue;
+        }
+        if (length > 0) {
+            token[length] = '\0';
+            length = 0;
+            ended = !replayToken(token);
+        }
     }
-    cleanMoves[j] = '\0';
-
-    // Replay moves to reconstruct board and moveHistory
-    replayMoves(cleanMoves);
+    if (!ended && length > 0) {
+        token[length] = '\0';
+        replayToken(token);
+    }
+    fclose(file);
 
     printf("Game loaded from PGN %s\n", filename);
     return 1;
@@ -0,0 +1,101 @@
+#include "trace.h"
+
+#ifdef CHESS_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_TRACE_MB 64
+
+static TraceHeader *header;     // start of the mapping
+static TraceRecord *records;
+static int traceFailed;         // set once opening failed, so it is not retried per search
+
+// Maps a fresh trace file of the configured size; the previous run's trace
+// is overwritten
+static int openTrace() {
+    const char *filename = getenv("CHESS_TRACE_FILE");
+    const char *sizeText = getenv("CHESS_TRACE_MB");
+    long megabytes = sizeText ? atol(sizeText) : DEFAULT_TRACE_MB;
+    if (!filename) filename = "search.trace";
+    if (megabytes <= 0) megabytes = DEFAULT_TRACE_MB;
+
+    uint64_t capacity = ((uint64_t)megabytes << 20) / sizeof(TraceRecord);
+    if (capacity > UINT32_MAX) capacity = UINT32_MAX;
+    size_t size = sizeof(TraceHeader) + (size_t)capacity * sizeof(TraceRecord);
+    void *view = NULL;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32),
+                                            (DWORD)size, NULL);
+        if (mapping) {
+            view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)size) == 0) {
+            view = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED) view = NULL;
+        }
+        close(fd);
+    }
+#endif
+    if (!view) {
+        fprintf(stderr, "Error: Could not map %s for the search trace\n", filename);
+        return 0;
+    }
+
+    header = view;
+    records = (TraceRecord *)(header + 1);
+    memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+    header->recordSize = sizeof(TraceRecord);
+    header->capacity = (uint32_t)capacity;
+    header->written = 0;
+    header->searches = 0;
+    return 1;
+}
+
+void traceBeginSearch() {
+    if (!header) {
+        if (traceFailed) return;
+        if (!openTrace()) {
+            traceFailed = 1;
+            return;
+        }
+    }
+    header->searches++;
+}
+
+void traceNode(uint64_t key, int ply, int depth, uint16_t move, int alpha, int beta, int score,
+               int type, int flags, int moveCount, int cutoff) {
+    if (!header) return;
+    TraceRecord *record = &records[header->written % header->capacity];
+    record->key = key;
+    record->alpha = alpha;
+    record->beta = beta;
+    record->score = score;
+    record->search = header->searches;
+    record->move = move;
+    record->ply = (uint8_t)ply;
+    record->depth = (uint8_t)depth;
+    record->type = (uint8_t)type;
+    record->flags = (uint8_t)flags;
+    record->moveCount = (uint8_t)moveCount;
+    record->cutoff = (uint8_t)cutoff;
+    header->written++;
+}
+#endif
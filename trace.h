@@ -0,0 +1,77 @@
+#ifndef C_CHESS_TRACE_H
+#define C_CHESS_TRACE_H
+
+#include <stdint.h>
+
+// Search tree trace. Built in only with CHESS_TRACE defined (CMake option of
+// the same name); otherwise every TRACE_* macro compiles to nothing.
+//
+// Every node the search leaves appends one fixed-size record to a ring of
+// records in a memory-mapped file (CHESS_TRACE_FILE, default search.trace;
+// CHESS_TRACE_MB megabytes, default 64). Records come in post-order: a node
+// follows all of its children, which are the records one ply deeper since
+// the previous record at its own ply or above. c_chess_trace rebuilds the
+// trees from the file. One thread searches at a time.
+
+#define TRACE_MAGIC "CCTRACE1"
+
+typedef enum {
+    TRACE_PV,               // score inside the window
+    TRACE_CUT,              // a move reached the far bound
+    TRACE_ALL,              // no move improved on the near bound
+    TRACE_LEAF,             // depth exhausted, statically evaluated
+    TRACE_TERMINAL,         // checkmate or stalemate
+    TRACE_DRAW,             // repetition or fifty-move draw, not searched
+    TRACE_ROOT,             // one iteration of the root, closing its tree
+    TRACE_HASH,             // answered by the transposition table, not searched
+    TRACE_TYPE_COUNT
+} TraceNodeType;
+
+#define TRACE_FLAG_RESEARCH 1   // searched again after a narrower search of the same move
+#define TRACE_NO_CUTOFF 255
+
+typedef struct {
+    uint64_t key;           // Zobrist key of the node
+    int32_t alpha;          // window on entry
+    int32_t beta;
+    int32_t score;          // value returned
+    uint32_t search;        // number of the search within the trace
+    uint16_t move;          // move leading to the node, MOVE_NONE at the root
+    uint8_t ply;
+    uint8_t depth;          // remaining depth on entry
+    uint8_t type;           // TraceNodeType
+    uint8_t flags;          // TRACE_FLAG_* bits
+    uint8_t moveCount;      // legal moves at an interior node
+    uint8_t cutoff;         // index of the move that cut off, or TRACE_NO_CUTOFF
+} TraceRecord;
+
+// Start of the trace file, followed by capacity records. Record n of the run
+// sits at slot n % capacity; written counts every record ever appended.
+typedef struct {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint64_t written;
+    uint32_t searches;
+    uint32_t reserved[9];
+} TraceHeader;
+
+#ifdef CHESS_TRACE
+void traceBeginSearch();
+void traceNode(uint64_t key, int ply, int depth, uint16_t move, int alpha, int beta, int score,
+               int type, int flags, int moveCount, int cutoff);
+
+#define TRACE_BEGIN_SEARCH() traceBeginSearch()
+// Keeps a copy of the node's window before the search narrows it, for the
+// TRACE_NODE calls that follow
+#define TRACE_WINDOW(alpha, beta) const int traceAlpha = (alpha), traceBeta = (beta)
+#define TRACE_NODE(key, ply, depth, move, alpha, beta, score, type, flags, moveCount, cutoff) \
+    traceNode(key, ply, depth, move, alpha, beta, score, type, flags, moveCount, cutoff)
+#else
+#define TRACE_BEGIN_SEARCH() ((void)0)
+#define TRACE_WINDOW(alpha, beta) ((void)0)
+// The search passes flags down only for the trace; use them so they are not unused
+#define TRACE_NODE(key, ply, depth, move, alpha, beta, score, type, flags, moveCount, cutoff) ((void)(flags))
+#endif
+
+#endif //C_CHESS_TRACE_H
@@ -0,0 +1,285 @@
+// Reads a search trace written with CHESS_TRACE, rebuilds the search trees
+// and reports, per iteration depth: node counts by type, the effective
+// branching factor, move-ordering quality and the work spent searching
+// something twice.
+//
+// Usage: c_chess_trace [-v] [trace file]
+//
+// -v also prints every iteration of every search. The file defaults to
+// search.trace. Once the ring has wrapped, the oldest iteration is
+// incomplete and is skipped.
+//
+// Re-searched work is reported three ways: nodes in iterations before the
+// last one of their search (the cost of iterative deepening), subtrees of
+// null-window scouts and root passes that were searched again with a wider
+// window, and nodes whose key and depth already came up earlier in the same
+// iteration (what the transposition table did not answer).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+#define MAX_PLY 256
+#define MAX_DEPTH 64
+
+static const char *typeNames[TRACE_TYPE_COUNT] = {"pv", "cut", "all", "leaf", "terminal", "draw", "root", "hash"};
+
+typedef struct {
+    unsigned long long nodes;
+    unsigned long long types[TRACE_TYPE_COUNT];
+    unsigned long long firstMoveCutoffs;
+    unsigned long long cutoffIndexSum;
+    unsigned long long researches;
+    unsigned long long researchWasted;      // nodes of the narrow searches redone
+    unsigned long long transposed;          // nodes whose key and depth repeat
+    unsigned long long previousNodes;       // nodes of the iteration one shallower
+    unsigned long long iterations;
+    unsigned long long malformed;           // nodes whose child count does not match
+} TraceStats;
+
+typedef struct {
+    uint64_t key;
+    int depth;
+} NodeKey;
+
+// Children seen so far of the open node at each ply
+typedef struct {
+    unsigned long long children;
+    unsigned long long subtreeNodes;
+    uint64_t lastKey;
+    unsigned long long lastSubtree;
+} PlyState;
+
+static PlyState plies[MAX_PLY + 1];
+
+static NodeKey *iterationKeys;
+static size_t iterationKeyCount, iterationKeyCapacity;
+
+static int compareNodeKeys(const void *a, const void *b) {
+    const NodeKey *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->depth > y->depth) - (x->depth < y->depth);
+}
+
+static int addIterationKey(uint64_t key, int depth) {
+    if (iterationKeyCount == iterationKeyCapacity) {
+        size_t capacity = iterationKeyCapacity ? iterationKeyCapacity * 2 : 4096;
+        NodeKey *grown = realloc(iterationKeys, capacity * sizeof(NodeKey));
+        if (!grown) return 0;
+        iterationKeys = grown;
+        iterationKeyCapacity = capacity;
+    }
+    iterationKeys[iterationKeyCount].key = key;
+    iterationKeys[iterationKeyCount].depth = depth;
+    iterationKeyCount++;
+    return 1;
+}
+
+// Nodes after the first with the same key and remaining depth
+static unsigned long long countTransposed() {
+    unsigned long long repeats = 0;
+    qsort(iterationKeys, iterationKeyCount, sizeof(NodeKey), compareNodeKeys);
+    for (size_t i = 1; i < iterationKeyCount; ++i) {
+        if (compareNodeKeys(&iterationKeys[i - 1], &iterationKeys[i]) == 0) repeats++;
+    }
+    return repeats;
+}
+
+static void addStats(TraceStats *total, const TraceStats *part) {
+    total->nodes += part->nodes;
+    for (int t = 0; t < TRACE_TYPE_COUNT; ++t) total->types[t] += part->types[t];
+    total->firstMoveCutoffs += part->firstMoveCutoffs;
+    total->cutoffIndexSum += part->cutoffIndexSum;
+    total->researches += part->researches;
+    total->researchWasted += part->researchWasted;
+    total->transposed += part->transposed;
+    total->previousNodes += part->previousNodes;
+    total->iterations += part->iterations;
+    total->malformed += part->malformed;
+}
+
+static void printHeading(const char *first) {
+    printf("%-8s %6s %12s %7s %6s %6s %7s %6s %8s %8s\n", first, "depth", "nodes", "ebf", "1st%",
+           "cutidx", "pv", "cut%", "resrch%", "transp%");
+}
+
+static double percent(unsigned long long part, unsigned long long whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+static void printStats(const char *label, int depth, const TraceStats *stats) {
+    unsigned long long cuts = stats->types[TRACE_CUT];
+    unsigned long long interior = stats->types[TRACE_PV] + cuts + stats->types[TRACE_ALL];
+    printf("%-8s %6d %12llu %7.2f %6.1f %6.2f %7llu %6.1f %8.2f %8.2f\n", label, depth, stats->nodes,
+           stats->previousNodes ? (double)stats->nodes / (double)stats->previousNodes : 0.0,
+           percent(stats->firstMoveCutoffs, cuts), cuts ? (double)stats->cutoffIndexSum / (double)cuts : 0.0,
+           stats->types[TRACE_PV], percent(cuts, interior), percent(stats->researchWasted, stats->nodes),
+           percent(stats->transposed, stats->nodes));
+}
+
+int main(int argc, char **argv) {
+    const char *filename = "search.trace";
+    int verbose = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (argv[i][0] == '-' || i + 1 < argc) {
+            fprintf(stderr, "Usage: %s [-v] [trace file]\n", argv[0]);
+            return 1;
+        } else {
+            filename = argv[i];
+        }
+    }
+
+    FILE *in = fopen(filename, "rb");
+    TraceHeader header;
+    if (!in || fread(&header, sizeof(header), 1, in) != 1) {
+        fprintf(stderr, "Error: Could not read %s\n", filename);
+        return 1;
+    }
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.recordSize != sizeof(TraceRecord) ||
+        header.capacity == 0) {
+        fprintf(stderr, "Error: %s is not a search trace\n", filename);
+        return 1;
+    }
+    uint64_t count = header.written < header.capacity ? header.written : header.capacity;
+    TraceRecord *records = malloc((size_t)header.capacity * sizeof(TraceRecord));
+    if (!records || fread(records, sizeof(TraceRecord), (size_t)header.capacity, in) != header.capacity) {
+        fprintf(stderr, "Error: Could not read the records of %s\n", filename);
+        return 1;
+    }
+    fclose(in);
+
+    TraceStats byDepth[MAX_DEPTH + 1];
+    TraceStats iteration, total;
+    memset(byDepth, 0, sizeof(byDepth));
+    memset(&iteration, 0, sizeof(iteration));
+    memset(&total, 0, sizeof(total));
+    unsigned long long previousRootNodes = 0;
+    uint32_t previousSearch = 0;
+    int previousDepth = 0;
+    unsigned long long searchNodes = 0;        // all iterations of the current search
+    unsigned long long earlierIterations = 0;  // nodes in iterations that were not the last
+    unsigned long long passStart = 0;         // nodes of the iteration before its current root pass
+    int skipping = header.written > header.capacity;
+    unsigned long long skipped = 0, searches = 0;
+
+    if (verbose) printHeading("search");
+    for (uint64_t n = header.written - count; n < header.written; ++n) {
+        const TraceRecord *record = &records[n % header.capacity];
+        if (skipping) {
+            skipped++;
+            if (record->type == TRACE_ROOT) skipping = 0;
+            continue;
+        }
+        int ply = record->ply;
+        PlyState *below = &plies[ply + 1];
+        unsigned long long subtree = 1 + below->subtreeNodes;
+        int interior = record->type == TRACE_PV || record->type == TRACE_CUT || record->type == TRACE_ALL ||
+                       record->type == TRACE_ROOT;
+        unsigned long long expected = !interior ? 0
+                                      : record->cutoff != TRACE_NO_CUTOFF ? record->cutoff + 1u
+                                                                          : record->moveCount;
+        if (below->children != expected || record->type >= TRACE_TYPE_COUNT) iteration.malformed++;
+        memset(below, 0, sizeof(*below));
+
+        iteration.nodes++;
+        if (record->type < TRACE_TYPE_COUNT) iteration.types[record->type]++;
+        if (record->type == TRACE_CUT && record->cutoff != TRACE_NO_CUTOFF) {
+            iteration.cutoffIndexSum += record->cutoff;
+            if (record->cutoff == 0) iteration.firstMoveCutoffs++;
+        }
+        // A re-search directly follows the narrow search of the same move
+        if ((record->flags & TRACE_FLAG_RESEARCH) && ply > 0) {
+            iteration.researches++;
+            if (plies[ply].children > 0 && plies[ply].lastKey == record->key) {
+                iteration.researchWasted += plies[ply].lastSubtree;
+            }
+        }
+
+        if (record->type != TRACE_ROOT) {
+            // A re-search is the same child searched again, not another one
+            if (!(record->flags & TRACE_FLAG_RESEARCH)) plies[ply].children++;
+            plies[ply].subtreeNodes += subtree;
+            plies[ply].lastKey = record->key;
+            plies[ply].lastSubtree = subtree;
+            if (!addIterationKey(record->key, record->depth)) {
+                fprintf(stderr, "Error: Could not allocate memory for the trace\n");
+                return 1;
+            }
+            continue;
+        }
+
+        // A root pass whose score fell outside its aspiration window is
+        // searched again at the same depth; its nodes stay in the iteration
+        // as re-search waste
+        if (record->score <= record->alpha || record->score >= record->beta) {
+            iteration.researches++;
+            iteration.researchWasted += iteration.nodes - passStart;
+            passStart = iteration.nodes;
+            continue;
+        }
+
+        // The root closes an iteration
+        int depth = record->depth < MAX_DEPTH ? record->depth : MAX_DEPTH;
+        int sameSearch = searches > 0 && record->search == previousSearch && depth == previousDepth + 1;
+        iteration.transposed = countTransposed();
+        iteration.previousNodes = sameSearch ? previousRootNodes : 0;
+        iteration.iterations = 1;
+        iterationKeyCount = 0;
+        memset(plies, 0, sizeof(plies));
+
+        if (!sameSearch) {
+            searches++;
+            earlierIterations += searchNodes - previousRootNodes;
+            searchNodes = 0;
+        }
+        searchNodes += iteration.nodes;
+        if (verbose) {
+            char label[16];
+            snprintf(label, sizeof(label), "%u", record->search);
+            printStats(label, depth, &iteration);
+        }
+        addStats(&byDepth[depth], &iteration);
+        addStats(&total, &iteration);
+        previousRootNodes = iteration.nodes;
+        previousSearch = record->search;
+        previousDepth = depth;
+        passStart = 0;
+        memset(&iteration, 0, sizeof(iteration));
+    }
+    earlierIterations += searchNodes - previousRootNodes;
+
+    if (verbose) printf("\n");
+    printf("%s: %llu records (%llu skipped), %llu searches, %llu iterations\n", filename,
+           (unsigned long long)count, skipped, searches, total.iterations);
+    if (total.iterations == 0) {
+        return 0;
+    }
+    printHeading("");
+    for (int depth = 0; depth <= MAX_DEPTH; ++depth) {
+        if (byDepth[depth].iterations) printStats("", depth, &byDepth[depth]);
+    }
+    printStats("total", 0, &total);
+
+    printf("\nNode types:");
+    for (int t = 0; t < TRACE_TYPE_COUNT; ++t) {
+        printf(" %s %llu (%.1f%%)%s", typeNames[t], total.types[t], percent(total.types[t], total.nodes),
+               t + 1 < TRACE_TYPE_COUNT ? "," : "\n");
+    }
+    printf("First-move cutoffs: %.1f%% of %llu cutoffs, mean cutoff index %.2f\n",
+           percent(total.firstMoveCutoffs, total.types[TRACE_CUT]), total.types[TRACE_CUT],
+           total.types[TRACE_CUT] ? (double)total.cutoffIndexSum / (double)total.types[TRACE_CUT] : 0.0);
+    printf("Re-searched: %.1f%% of nodes in earlier iterations, %llu window re-searches wasting %llu nodes "
+           "(%.2f%%), %llu transposed nodes (%.2f%%)\n",
+           percent(earlierIterations, total.nodes), total.researches, total.researchWasted,
+           percent(total.researchWasted, total.nodes), total.transposed, percent(total.transposed, total.nodes));
+    if (total.malformed) {
+        printf("Warning: %llu nodes with a child count that does not match their record\n", total.malformed);
+    }
+    free(records);
+    free(iterationKeys);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transposition.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define FILL_SAMPLE_BUCKETS 250
+
+_Static_assert(sizeof(TranspositionBucket) == 64, "a bucket must fill one cache line");
+
+TranspositionBucket *transpositionTable;
+uint64_t transpositionMask;
+
+static size_t tableBytes;
+static _Atomic unsigned generation; // advanced by every search; entries keep the low 6 bits
+
+static _Atomic unsigned long long totalProbes;
+static _Atomic unsigned long long totalHits;
+static _Atomic unsigned long long totalCutoffs;
+
+// Anonymous page-aligned memory, zeroed. Where the kernel supports it the
+// table is aligned to and advised for transparent huge pages, since every
+// probe lands on a random page.
+static void *mapTable(size_t bytes) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MADV_HUGEPAGE
+    if (bytes >= HUGE_PAGE_SIZE) {
+        // Over-map by one huge page and trim both ends to an aligned range
+        char *raw = mmap(NULL, bytes + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (raw == MAP_FAILED) return NULL;
+        char *aligned = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (aligned > raw) munmap(raw, (size_t)(aligned - raw));
+        munmap(aligned + bytes, (size_t)(raw + HUGE_PAGE_SIZE - aligned));
+        madvise(aligned, bytes, MADV_HUGEPAGE);
+        return aligned;
+    }
+#endif
+    void *table = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+    return table == MAP_FAILED ? NULL : table;
+#endif
+}
+
+static void unmapTable(void *table, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(table, 0, MEM_RELEASE);
+#else
+    munmap(table, bytes);
+#endif
+}
+
+int resizeTranspositionTable(size_t megabytes) {
+    size_t buckets = 1;
+    while (buckets * 2 * sizeof(TranspositionBucket) <= megabytes * 1024 * 1024) buckets *= 2;
+
+    if (transpositionTable) {
+        unmapTable(transpositionTable, tableBytes);
+        transpositionTable = NULL;
+    }
+    tableBytes = buckets * sizeof(TranspositionBucket);
+    TranspositionBucket *table = mapTable(tableBytes);
+    if (!table) {
+        fprintf(stderr, "Error: Could not allocate a %zu MB transposition table\n", megabytes);
+        tableBytes = 0;
+        return 0;
+    }
+    transpositionMask = buckets - 1;
+    transpositionTable = table;
+    atomic_store(&totalProbes, 0);
+    atomic_store(&totalHits, 0);
+    atomic_store(&totalCutoffs, 0);
+    return 1;
+}
+
+void clearTranspositionTable() {
+    if (transpositionTable) memset(transpositionTable, 0, tableBytes);
+}
+
+int initTranspositionTable() {
+    const char *sizeText = getenv("CHESS_HASH_MB");
+    long megabytes = sizeText ? atol(sizeText) : DEFAULT_HASH_MB;
+    return resizeTranspositionTable(megabytes > 0 ? (size_t)megabytes : DEFAULT_HASH_MB);
+}
+
+void ageTranspositionTable() {
+    atomic_fetch_add_explicit(&generation, 1, memory_order_relaxed);
+}
+
+static inline unsigned currentGeneration() {
+    return atomic_load_explicit(&generation, memory_order_relaxed) & 63;
+}
+
+static inline uint64_t packEntry(Move move, int depth, int bound, int score, unsigned age) {
+    return (uint64_t)(uint32_t)score | (uint64_t)move << 32 | (uint64_t)(depth & 0xFF) << 48 |
+           (uint64_t)bound << 56 | (uint64_t)age << 58;
+}
+
+static inline int entryDepth(uint64_t data) { return (int)(data >> 48 & 0xFF); }
+static inline unsigned entryGeneration(uint64_t data) { return (unsigned)(data >> 58); }
+
+int probeTransposition(uint64_t key, TranspositionEntry *entry) {
+    if (!transpositionTable) return 0;
+    TranspositionSlot *slots = transpositionTable[key & transpositionMask].slots;
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; ++i) {
+        uint64_t data = atomic_load_explicit(&slots[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&slots[i].check, memory_order_relaxed);
+        if (data == 0 || (check ^ data) != key) continue;
+        entry->score = (int32_t)(uint32_t)data;
+        entry->move = (Move)(data >> 32);
+        entry->depth = entryDepth(data);
+        entry->bound = (int)(data >> 56 & 3);
+        return 1;
+    }
+    return 0;
+}
+
+void storeTransposition(uint64_t key, Move move, int depth, int bound, int score) {
+    if (!transpositionTable) return;
+    TranspositionSlot *slots = transpositionTable[key & transpositionMask].slots;
+    TranspositionSlot *victim = NULL;
+    int victimWorth = 0;
+    unsigned age = currentGeneration();
+
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; ++i) {
+        uint64_t data = atomic_load_explicit(&slots[i].data, memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&slots[i].check, memory_order_relaxed);
+        if (data == 0) {
+            victim = &slots[i];
+            break;
+        }
+        if ((check ^ data) == key) {
+            // Keep a deeper result of this search unless the new one is exact
+            if (bound != BOUND_EXACT && entryGeneration(data) == age && entryDepth(data) > depth + 2) {
+                return;
+            }
+            if (move == MOVE_NONE) move = (Move)(data >> 32);
+            victim = &slots[i];
+            break;
+        }
+        // Each generation of age counts as eight plies of depth
+        int worth = entryDepth(data) - 8 * (int)((age - entryGeneration(data)) & 63);
+        if (!victim || worth < victimWorth) {
+            victim = &slots[i];
+            victimWorth = worth;
+        }
+    }
+
+    uint64_t data = packEntry(move, depth, bound, score, age);
+    atomic_store_explicit(&victim->check, key ^ data, memory_order_relaxed);
+    atomic_store_explicit(&victim->data, data, memory_order_relaxed);
+}
+
+void addTranspositionCounts(unsigned long long probes, unsigned long long hits, unsigned long long cutoffs) {
+    atomic_fetch_add_explicit(&totalProbes, probes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&totalHits, hits, memory_order_relaxed);
+    atomic_fetch_add_explicit(&totalCutoffs, cutoffs, memory_order_relaxed);
+}
+
+void getTranspositionStats(TranspositionStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!transpositionTable) return;
+    stats->bytes = tableBytes;
+    stats->entries = (transpositionMask + 1) * TRANSPOSITION_BUCKET_SIZE;
+    stats->probes = atomic_load_explicit(&totalProbes, memory_order_relaxed);
+    stats->hits = atomic_load_explicit(&totalHits, memory_order_relaxed);
+    stats->cutoffs = atomic_load_explicit(&totalCutoffs, memory_order_relaxed);
+
+    // Share of the first buckets' entries written in the current generation
+    uint64_t buckets = transpositionMask + 1 < FILL_SAMPLE_BUCKETS ? transpositionMask + 1 : FILL_SAMPLE_BUCKETS;
+    unsigned age = currentGeneration();
+    int filled = 0;
+    for (uint64_t b = 0; b < buckets; ++b) {
+        for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; ++i) {
+            uint64_t data = atomic_load_explicit(&transpositionTable[b].slots[i].data, memory_order_relaxed);
+            if (data != 0 && entryGeneration(data) == age) filled++;
+        }
+    }
+    stats->fillPermille = (int)(1000 * (uint64_t)filled / (buckets * TRANSPOSITION_BUCKET_SIZE));
+}
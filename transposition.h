@@ -0,0 +1,96 @@
+#ifndef C_CHESS_TRANSPOSITION_H
+#define C_CHESS_TRANSPOSITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "chess.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Search transposition table, shared by every search in the process. Each
+// 64-byte bucket holds four entries of best move, remaining depth, bound and
+// score. Entries are stored as key ^ data next to data, so threads read and
+// write them without locks; a torn entry fails the key check and is a miss.
+//
+// The program allocates the table once at startup, before any search runs,
+// so searches on several threads never race to create it and no search pays
+// for the mapping. A search with no table runs without one. The table
+// persists between searches; every search starts a new generation, and a
+// store replaces the shallowest entry of its bucket, counting each generation
+// of age as eight plies of depth.
+
+#define TRANSPOSITION_BUCKET_SIZE 4
+#define DEFAULT_HASH_MB 16
+
+typedef enum {
+    BOUND_NONE,
+    BOUND_UPPER,            // every move failed low: score is at most this
+    BOUND_LOWER,            // a move failed high: score is at least this
+    BOUND_EXACT
+} TranspositionBound;
+
+typedef struct {
+    _Atomic uint64_t check;     // key ^ data
+    _Atomic uint64_t data;      // score | move << 32 | depth << 48 | bound << 56 | generation << 58
+} TranspositionSlot;
+
+typedef struct {
+    TranspositionSlot slots[TRANSPOSITION_BUCKET_SIZE];
+} TranspositionBucket;
+
+// What a probe found
+typedef struct {
+    Move move;              // MOVE_NONE if the entry has none
+    int score;              // side to move's point of view, mates counted from this node
+    int depth;
+    int bound;              // TranspositionBound
+} TranspositionEntry;
+
+typedef struct {
+    size_t bytes;
+    unsigned long long entries;
+    unsigned long long probes;
+    unsigned long long hits;
+    unsigned long long cutoffs;     // hits that answered the node without a search
+    int fillPermille;               // sampled share of entries written by the last search
+} TranspositionStats;
+
+extern TranspositionBucket *transpositionTable;
+extern uint64_t transpositionMask;
+
+// Replace the table with an empty one of the given size. Not safe while a
+// search is running. Returns 0 and leaves the search without a table if the
+// memory cannot be mapped.
+int resizeTranspositionTable(size_t megabytes);
+
+// Allocate the table at startup: CHESS_HASH_MB megabytes (default 16)
+// rounded down to a power of two buckets
+int initTranspositionTable();
+
+// Forget every entry, for a search that does not depend on earlier ones
+void clearTranspositionTable();
+
+// Start a new search by advancing the generation. Safe to call from
+// searches on several threads.
+void ageTranspositionTable();
+
+int probeTransposition(uint64_t key, TranspositionEntry *entry);
+void storeTransposition(uint64_t key, Move move, int depth, int bound, int score);
+
+// Add one search's probe counts to the table statistics
+void addTranspositionCounts(unsigned long long probes, unsigned long long hits, unsigned long long cutoffs);
+void getTranspositionStats(TranspositionStats *stats);
+
+// Start loading the bucket of a position about to be searched
+static inline void prefetchTransposition(uint64_t key) {
+    if (!transpositionTable) return;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&transpositionTable[key & transpositionMask]);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch((const char *)&transpositionTable[key & transpositionMask], _MM_HINT_T0);
+#endif
+}
+
+#endif //C_CHESS_TRANSPOSITION_H
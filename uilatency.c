@@ -0,0 +1,229 @@
+#include "uilatency.h"
+
+#ifdef CHESS_UI_LATENCY
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_STALL_MS 50
+#define MAX_CALLBACKS 16
+// Four buckets per power of two: bucket bounds are at most 25% apart
+#define SUB_BUCKETS 4
+#define BUCKET_COUNT 128
+
+typedef struct {
+    const char *name;       // NULL for GTK's own work
+    unsigned long long dispatches;
+    gint64 totalUs;
+    gint64 maxUs;
+    unsigned long long stalls;
+} CallbackStats;
+
+typedef struct {
+    const char *name;
+    GSourceFunc func;
+    gpointer data;
+} TrackedSource;
+
+typedef struct {
+    const char *name;
+    GCallback handler;
+    gpointer data;
+    GClosureNotify destroy;
+} TrackedHandler;
+
+// All of this is only touched from the main loop's thread
+static unsigned long long histogram[BUCKET_COUNT];
+static unsigned long long spanCount;
+static unsigned long long stallCount;
+static gint64 maxSpanUs;
+static gint64 stallThresholdUs;
+static CallbackStats callbacks[MAX_CALLBACKS];
+static int callbackCount;
+
+static gint64 busySince;            // end of the last poll, 0 while polling
+static const char *spanCallback;    // last named callback run since then
+
+static int bucketFor(gint64 us) {
+    if (us < SUB_BUCKETS) return us < 0 ? 0 : (int)us;
+    int msb = g_bit_storage((gulong)us) - 1;
+    int bucket = SUB_BUCKETS * (msb - 1) + (int)((us >> (msb - 2)) & (SUB_BUCKETS - 1));
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+// Smallest span that lands in the bucket
+static gint64 bucketStart(int bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int msb = bucket / SUB_BUCKETS + 1;
+    return (gint64)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (msb - 2);
+}
+
+static CallbackStats *statsFor(const char *name) {
+    for (int i = 0; i < callbackCount; ++i) {
+        if (callbacks[i].name == name || (name && callbacks[i].name && strcmp(callbacks[i].name, name) == 0)) {
+            return &callbacks[i];
+        }
+    }
+    if (callbackCount == MAX_CALLBACKS) {
+        return &callbacks[MAX_CALLBACKS - 1];
+    }
+    callbacks[callbackCount].name = name;
+    return &callbacks[callbackCount++];
+}
+
+static void recordSpan(gint64 us, const char *name) {
+    CallbackStats *stats = statsFor(name);
+
+    histogram[bucketFor(us)]++;
+    spanCount++;
+    if (us > maxSpanUs) maxSpanUs = us;
+    stats->dispatches++;
+    stats->totalUs += us;
+    if (us > stats->maxUs) stats->maxUs = us;
+    if (us >= stallThresholdUs) {
+        stallCount++;
+        stats->stalls++;
+        fprintf(stderr, "UI stall: %.1f ms in %s\n", us / 1000.0, name ? name : "(gtk)");
+    }
+}
+
+// Upper bound of the span below which the given fraction of spans fall
+static gint64 spanPercentile(double fraction) {
+    unsigned long long rank = (unsigned long long)(fraction * spanCount + 0.999999);
+    unsigned long long seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += histogram[i];
+        if (seen >= rank && seen) {
+            gint64 bound = i + 1 < BUCKET_COUNT ? bucketStart(i + 1) - 1 : maxSpanUs;
+            return bound < maxSpanUs ? bound : maxSpanUs;
+        }
+    }
+    return maxSpanUs;
+}
+
+// The monitor never becomes ready; it only watches the loop go round. A
+// nested loop (gtk_dialog_run) closes the span of the callback that opened
+// it at its first prepare and opens a new one once it stops polling.
+static gboolean monitorPrepare(GSource *source, gint *timeout) {
+    (void)source;
+    if (busySince) {
+        recordSpan(g_get_monotonic_time() - busySince, spanCallback);
+    }
+    busySince = 0;
+    spanCallback = NULL;
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean monitorCheck(GSource *source) {
+    (void)source;
+    busySince = g_get_monotonic_time();
+    return FALSE;
+}
+
+static gboolean monitorDispatch(GSource *source, GSourceFunc callback, gpointer data) {
+    (void)source;
+    (void)callback;
+    (void)data;
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs monitorFuncs = {monitorPrepare, monitorCheck, monitorDispatch, NULL, NULL, NULL};
+
+void startUiLatencyMonitor() {
+    const char *threshold = getenv("CHESS_UI_STALL_MS");
+    int ms = threshold ? atoi(threshold) : 0;
+    stallThresholdUs = (gint64)(ms > 0 ? ms : DEFAULT_STALL_MS) * 1000;
+
+    // Highest priority, so it is prepared and checked on every iteration
+    GSource *source = g_source_new(&monitorFuncs, sizeof(GSource));
+    g_source_set_priority(source, G_PRIORITY_HIGH);
+    g_source_set_name(source, "UI latency monitor");
+    g_source_attach(source, NULL);
+    g_source_unref(source);
+}
+
+static gboolean runTrackedSource(gpointer user) {
+    TrackedSource *tracked = user;
+    spanCallback = tracked->name;
+    gboolean again = tracked->func(tracked->data);
+    spanCallback = tracked->name;
+    return again;
+}
+
+guint uiTimeoutAdd(guint interval, GSourceFunc func, gpointer data, const char *name) {
+    TrackedSource *tracked = g_new(TrackedSource, 1);
+    tracked->name = name;
+    tracked->func = func;
+    tracked->data = data;
+    return g_timeout_add_full(G_PRIORITY_DEFAULT, interval, runTrackedSource, tracked, g_free);
+}
+
+guint uiTimeoutAddSeconds(guint interval, GSourceFunc func, gpointer data, const char *name) {
+    TrackedSource *tracked = g_new(TrackedSource, 1);
+    tracked->name = name;
+    tracked->func = func;
+    tracked->data = data;
+    return g_timeout_add_seconds_full(G_PRIORITY_DEFAULT, interval, runTrackedSource, tracked, g_free);
+}
+
+static void runTrackedHandler(GtkWidget *widget, gpointer user) {
+    TrackedHandler *tracked = user;
+    spanCallback = tracked->name;
+    ((void (*)(GtkWidget *, gpointer))tracked->handler)(widget, tracked->data);
+    spanCallback = tracked->name;
+}
+
+static void freeTrackedHandler(gpointer user, GClosure *closure) {
+    TrackedHandler *tracked = user;
+    if (tracked->destroy) tracked->destroy(tracked->data, closure);
+    g_free(tracked);
+}
+
+gulong uiConnectClicked(gpointer instance, GCallback handler, gpointer data,
+                        GClosureNotify destroy, const char *name) {
+    TrackedHandler *tracked = g_new(TrackedHandler, 1);
+    tracked->name = name;
+    tracked->handler = handler;
+    tracked->data = data;
+    tracked->destroy = destroy;
+    return g_signal_connect_data(instance, "clicked", G_CALLBACK(runTrackedHandler), tracked,
+                                 freeTrackedHandler, 0);
+}
+
+// Space left in an output buffer after length characters, as snprintf counts
+static size_t room(int length, size_t size) {
+    return (size_t)length < size ? size - (size_t)length : 0;
+}
+
+void formatUiLatencyReport(char *out, size_t size) {
+    int length = snprintf(out, size, "UI dispatches: %llu, p50 %.2f ms, p95 %.2f ms, max %.1f ms\n",
+                          spanCount, spanPercentile(0.5) / 1000.0, spanPercentile(0.95) / 1000.0,
+                          maxSpanUs / 1000.0);
+    length += snprintf(out + length, room(length, size), "Stalls over %lld ms: %llu (%.2f%% within budget)\n",
+                       (long long)(stallThresholdUs / 1000), stallCount,
+                       spanCount ? 100.0 * (double)(spanCount - stallCount) / (double)spanCount : 100.0);
+    length += snprintf(out + length, room(length, size), "%-28s %10s %10s %10s %8s\n",
+                       "callback", "dispatches", "mean ms", "max ms", "stalls");
+    for (int i = 0; i < callbackCount; ++i) {
+        const CallbackStats *stats = &callbacks[i];
+        length += snprintf(out + length, room(length, size), "%-28s %10llu %10.2f %10.1f %8llu\n",
+                           stats->name ? stats->name : "(gtk)", stats->dispatches,
+                           stats->totalUs / 1000.0 / (double)stats->dispatches, stats->maxUs / 1000.0,
+                           stats->stalls);
+    }
+}
+
+void dumpUiLatency() {
+    char report[2048];
+    const char *filename = getenv("CHESS_UI_LATENCY_FILE");
+    FILE *out = filename ? fopen(filename, "a") : stderr;
+    if (!out) {
+        fprintf(stderr, "Error: Could not open %s for UI latency\n", filename);
+        return;
+    }
+    formatUiLatencyReport(report, sizeof(report));
+    fprintf(out, "%s", report);
+    if (out != stderr) fclose(out);
+}
+#endif
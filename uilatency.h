@@ -0,0 +1,44 @@
+#ifndef C_CHESS_UILATENCY_H
+#define C_CHESS_UILATENCY_H
+
+#include <gtk/gtk.h>
+
+// GTK main-loop latency monitor. Built in only with CHESS_UI_LATENCY defined
+// (CMake option of the same name); otherwise the UI_* macros fall through to
+// the plain GLib calls.
+//
+// A monitor source on the default main context timestamps the end of every
+// poll and the start of the next one. The span in between is time the loop
+// spent dispatching, when it could neither redraw nor take input; every span
+// goes into a log-scale histogram. Callbacks registered through the macros
+// below carry their name, so a span over the stall threshold
+// (CHESS_UI_STALL_MS milliseconds, default 50) is logged with the callback
+// that ran in it. Spans without one are GTK's own drawing, layout and input.
+// Time inside a modal dialog is spent polling and is not counted.
+#ifdef CHESS_UI_LATENCY
+void startUiLatencyMonitor();
+guint uiTimeoutAdd(guint interval, GSourceFunc func, gpointer data, const char *name);
+guint uiTimeoutAddSeconds(guint interval, GSourceFunc func, gpointer data, const char *name);
+gulong uiConnectClicked(gpointer instance, GCallback handler, gpointer data,
+                        GClosureNotify destroy, const char *name);
+void formatUiLatencyReport(char *out, size_t size);
+void dumpUiLatency();
+
+#define UI_LATENCY_START() startUiLatencyMonitor()
+#define UI_TIMEOUT_ADD(interval, func, data) uiTimeoutAdd(interval, func, data, #func)
+#define UI_TIMEOUT_ADD_SECONDS(interval, func, data) uiTimeoutAddSeconds(interval, func, data, #func)
+#define UI_CONNECT_CLICKED(instance, handler, data, destroy) \
+    uiConnectClicked(instance, G_CALLBACK(handler), data, destroy, #handler)
+// Histogram and per-callback table, appended to the file named by
+// CHESS_UI_LATENCY_FILE or written to stderr
+#define UI_LATENCY_DUMP() dumpUiLatency()
+#else
+#define UI_LATENCY_START() ((void)0)
+#define UI_TIMEOUT_ADD(interval, func, data) g_timeout_add(interval, func, data)
+#define UI_TIMEOUT_ADD_SECONDS(interval, func, data) g_timeout_add_seconds(interval, func, data)
+#define UI_CONNECT_CLICKED(instance, handler, data, destroy) \
+    g_signal_connect_data(instance, "clicked", G_CALLBACK(handler), data, destroy, 0)
+#define UI_LATENCY_DUMP() ((void)0)
+#endif
+
+#endif //C_CHESS_UILATENCY_H